@@ -51,6 +51,9 @@ class RuntimeError {
  *    of base operator such as safe_div (which is wrapper function for
  *    processing zero-division), and [6, 10] is to do cond-reduction
  *    as most as we can for less time provement.
+ *
+ *  The macro is the default level only, which can be changed at
+ *    runtime globally or per operator, see SetSimplifyLevel.
  **/
 #ifndef SIMPLIFY_LEVEL
 #define SIMPLIFY_LEVEL 5
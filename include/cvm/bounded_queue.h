@@ -0,0 +1,106 @@
+#ifndef Z3_PROVER_BOUNDED_QUEUE_H
+#define Z3_PROVER_BOUNDED_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace z3 {
+namespace utils {
+
+/*
+ * Bounded multi-producer multi-consumer queue without lock.
+ *
+ *  Every cell carries a sequence number, which tells whether the
+ *  cell is free for the producer of the position, or filled for
+ *  the consumer of the position. Producers and consumers claim
+ *  positions by compare-and-swap on the tail and head, so the
+ *  operations never block and fail instead on full or empty
+ *  queue, which the caller backs off and retries.
+ *
+ *  Capacity is rounded up to the power of two, and values are
+ *  moved in and out of the cells.
+ **/
+template<typename T>
+class BoundedQueue {
+ public:
+  explicit BoundedQueue(size_t capacity) {
+    size_t n = 2;
+    while (n < capacity) n <<= 1;
+    mask_ = n - 1;
+    cells_.reset(new Cell[n]);
+    for (size_t i = 0; i < n; ++i) {
+      cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+  }
+  BoundedQueue(BoundedQueue const&) = delete;
+  BoundedQueue& operator=(BoundedQueue const&) = delete;
+
+  inline size_t capacity() const { return mask_ + 1; }
+
+  // Returns false if the queue is full, the value is kept.
+  bool try_push(T &value) {
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    Cell *cell;
+    while (true) {
+      cell = &cells_[pos & mask_];
+      size_t seq = cell->seq.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) -
+        static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(
+              pos, pos + 1, std::memory_order_relaxed)) break;
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->data = std::move(value);
+    cell->seq.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Returns false if the queue is empty.
+  bool try_pop(T *value) {
+    size_t pos = head_.load(std::memory_order_relaxed);
+    Cell *cell;
+    while (true) {
+      cell = &cells_[pos & mask_];
+      size_t seq = cell->seq.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) -
+        static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (head_.compare_exchange_weak(
+              pos, pos + 1, std::memory_order_relaxed)) break;
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = head_.load(std::memory_order_relaxed);
+      }
+    }
+    *value = std::move(cell->data);
+    cell->data = T();
+    cell->seq.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> seq;
+    T data;
+  };
+
+  std::unique_ptr<Cell[]> cells_;
+  size_t mask_;
+  // Separated cache lines, producers and consumers don't share.
+  alignas(64) std::atomic<size_t> tail_{0};
+  alignas(64) std::atomic<size_t> head_{0};
+};
+
+}
+}
+
+#endif // Z3_PROVER_BOUNDED_QUEUE_H
@@ -0,0 +1,70 @@
+#ifndef Z3_CVM_CANONICAL_H
+#define Z3_CVM_CANONICAL_H
+
+#include <cstdint>
+#include <vector>
+
+#include "z3++.h"
+#include "z3_types.h"
+
+namespace z3 {
+namespace cvm {
+
+/*
+ * Hash of expression structure, covering declaration names,
+ *  sorts and numerals. It's stable across processes and
+ *  contexts, unlike ast id. Hashes of different seeds mix every
+ *  node differently, so one is the check of another.
+ **/
+uint64_t structural_hash(expr const& e,
+                         uint64_t seed = 14695981039346656037ULL);
+
+/*
+ * Alpha-canonical form of obligation.
+ *
+ *  Free symbols are renamed in order of first appearance of
+ *  a left-to-right depth first traversal, so obligations which
+ *  are equal up to symbol renaming, such as `a_17 + b_17` and
+ *  `a_0 + b_0`, share the same canonical form. Since z3 asts
+ *  are hash-consed, equal forms have the same ast id within
+ *  a context.
+ **/
+class CanonicalForm {
+ public:
+  explicit CanonicalForm(expr const& e);
+
+  inline expr const& form() const { return form_; }
+  inline unsigned id() const { return form_.id(); }
+  // Number of free symbols renamed.
+  inline size_t num_symbols() const { return num_symbols_; }
+  // Stable hash of canonical form, the key of ProofCache.
+  inline uint64_t hash(uint64_t seed = 14695981039346656037ULL) const {
+    return structural_hash(form_, seed);
+  }
+
+ private:
+  expr form_;
+  size_t num_symbols_{0};
+};
+
+/*
+ * FNV-1a hash helpers.
+ **/
+uint64_t hash_bytes(const void *data, size_t size,
+                    uint64_t seed = 14695981039346656037ULL);
+inline uint64_t hash_combine(uint64_t seed, uint64_t v) {
+  return hash_bytes(&v, sizeof(v), seed);
+}
+
+/*
+ * Group obligations into alpha-equivalence classes, returns the
+ *  representative index of each obligation, which is the index
+ *  of first obligation in the same class.
+ **/
+std::vector<size_t> canonical_classes(
+    std::vector<type::z3_expr> const& proves);
+
+}
+}
+
+#endif // Z3_CVM_CANONICAL_H
@@ -0,0 +1,126 @@
+#ifndef Z3_CVM_CONCRETE_H
+#define Z3_CVM_CONCRETE_H
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "z3_types.h"
+
+namespace z3 {
+namespace cvm {
+
+/*
+ * Tensor of concrete executor, the elements are kept in int64
+ *  as the symbolic data do, so that the int32 overflow of CVM
+ *  is observed against the precision instead of wrapped.
+ **/
+struct ConcreteTensor {
+  type::Shape shape;
+  std::vector<int64_t> data;
+
+  ConcreteTensor() = default;
+  explicit ConcreteTensor(type::Shape const& shp)
+    : shape(shp), data(shp.Size(), 0) {}
+
+  inline size_t Size() const { return data.size(); }
+};
+
+/*
+ * Faults of concrete execution, which are the operator
+ *  constraints of symbolic data: int64 overflow of add, sub,
+ *  mul, div and neg, shift bits out of [0, 31] and left shift
+ *  of operand beyond int32. Only the first fault is described.
+ **/
+class ConcreteFaults {
+ public:
+  inline void record(const std::string &what) {
+    if (count_++ == 0) first_ = what;
+  }
+  // Records the fault if flag is set by the checked arithmetic.
+  inline void check(bool flag, const std::string &what) {
+    if (flag) record(what);
+  }
+
+  inline bool empty() const { return count_ == 0; }
+  inline size_t count() const { return count_; }
+  inline const std::string& first() const { return first_; }
+
+ private:
+  size_t count_{0};
+  std::string first_;
+};
+
+/*
+ * Checked arithmetic in the semantics of the z3 helpers, the
+ *  fault flag is or-ed instead of branched on, so that the loops
+ *  of kernels over contiguous data stay vectorizable.
+ **/
+namespace concrete {
+
+inline int64_t add(int64_t a, int64_t b, bool &fault) {
+  int64_t r;
+  fault |= __builtin_add_overflow(a, b, &r);
+  return r;
+}
+
+inline int64_t sub(int64_t a, int64_t b, bool &fault) {
+  int64_t r;
+  fault |= __builtin_sub_overflow(a, b, &r);
+  return r;
+}
+
+inline int64_t mul(int64_t a, int64_t b, bool &fault) {
+  int64_t r;
+  fault |= __builtin_mul_overflow(a, b, &r);
+  return r;
+}
+
+inline int64_t neg(int64_t a, bool &fault) {
+  return sub(0, a, fault);
+}
+
+inline int64_t abs(int64_t a, bool &fault) {
+  return a < 0 ? neg(a, fault) : a;
+}
+
+// Truncated toward zero, and zero if divided by zero.
+inline int64_t div(int64_t a, int64_t b, bool &fault) {
+  bool overflow = a == std::numeric_limits<int64_t>::min() && b == -1;
+  fault |= overflow;
+  return (b == 0 || overflow) ? 0 : a / b;
+}
+
+// Arithmetic shift, rounded toward negative infinity.
+inline int64_t shr(int64_t a, int64_t b, bool &fault) {
+  bool invalid = b < 0 || b > 31;
+  fault |= invalid;
+  return invalid ? 0 : (a >> b);
+}
+
+inline int64_t shl(int64_t a, int64_t b, bool &fault) {
+  bool invalid = b < 0 || b > 31 ||
+    a < -type::Z3_INT32_MAX || a > type::Z3_INT32_MAX;
+  fault |= invalid;
+  return invalid ? 0 : a * (int64_t(1) << b);
+}
+
+inline int64_t max(int64_t a, int64_t b) { return a > b ? a : b; }
+inline int64_t min(int64_t a, int64_t b) { return a > b ? b : a; }
+
+inline int64_t clip(int64_t a, int64_t lo, int64_t hi) {
+  return max(lo, min(a, hi));
+}
+
+// Positive range of precision, which is (1 << (prec - 1)) - 1.
+inline int64_t prec_range(int64_t prec) {
+  return (int64_t(1) << (prec - 1)) - 1;
+}
+
+}
+
+}
+}
+
+#endif // Z3_CVM_CONCRETE_H
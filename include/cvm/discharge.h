@@ -0,0 +1,117 @@
+#ifndef Z3_CVM_DISCHARGE_H
+#define Z3_CVM_DISCHARGE_H
+
+#include <vector>
+
+#include "z3++.h"
+#include "z3_types.h"
+
+namespace z3 {
+namespace cvm {
+
+// Collect conjuncts of nested and-tree, except true.
+void flatten_and(expr const& e, std::vector<expr> &conjuncts);
+
+/*
+ * Syntactic discharge of data-movement obligations.
+ *
+ *  Obligation `implies(in, out)` of reshape, transpose, slice
+ *  and so on only copies input element into output, which is
+ *  of the form
+ *
+ *    in:  range(a_j, a_prec) && o_i == a_j && o_prec == a_prec
+ *    out: range(o_i, o_prec)
+ *
+ *  The symbol equalities of `in` are merged with union-find,
+ *  and every symbol is substituted by the representative of its
+ *  class. Since `in` implies all the equalities, each conjunct
+ *  is equivalent with the substituted one under `in`, so the
+ *  obligation holds if every substituted conjunct of `out` is
+ *  one of the substituted conjuncts of `in`, which is checked
+ *  via hash-consed ast id without any solver.
+ *
+ *  Returns false if the obligation is not recognized, which
+ *  doesn't mean the obligation is invalid.
+ **/
+bool syntactic_discharge(expr const& cstr);
+
+/*
+ * Interval discharge of range obligations.
+ *
+ *  Most obligations of elementwise, clip and shift operators are
+ *  range facts following from the precision of inputs, such as
+ *  `relu(a) in [-bit_range(p), bit_range(p)]`. The analyzer
+ *  propagates signed intervals through bit-vector operators
+ *  with overflow detection, and splits cases on every value of
+ *  precision symbols, whose numeral domain is [1, 32], so that
+ *  bit ranges of precision are exact in each case.
+ *
+ *  Returns true if every conjunct of consequent is true in all
+ *  the cases, false means unknown.
+ **/
+bool interval_discharge(expr const& cstr);
+
+/*
+ * Narrow the bit-vectors of obligation to the smallest width.
+ *
+ *  Data are 64 bits placeholder, while the values of most
+ *  obligations are bounded by small precision. If interval
+ *  analysis shows that every bit-vector term fits in w signed
+ *  bits under the antecedent, each term of a 64 bits model
+ *  truncates to the value of the same term in w bits, since
+ *  addition, multiplication and shift commute with truncation,
+ *  and comparison, division and right shift see the exact
+ *  operands. So any counterexample of original obligation
+ *  truncates to a counterexample of the narrowed one, that is,
+ *  the narrowed obligation is valid only if original is.
+ *
+ *  The converse doesn't hold, counterexample of the narrowed
+ *  obligation must be checked against the original one.
+ *
+ *  Returns the narrowed width, or 0 if the obligation is kept.
+ **/
+unsigned narrow_width(expr const& cstr, expr *narrowed);
+
+/*
+ * Lemma of multiply-accumulate, proved once per process in
+ *  integer arithmetic:
+ *
+ *    |x| <= rx && |w| <= rw  =>  |x * w| <= rx * rw
+ *    |s| <= bs && |t| <= bt  =>  |s + t| <= bs + bt
+ *
+ *  Returns false if z3 fails to prove it within the budget.
+ **/
+bool mac_lemma();
+
+/*
+ * Compositional discharge of multiply-accumulate outputs, such
+ *  as dense and conv2d, whose data `y_i` is assigned with a sum
+ *  of products `x_j * w_k`, zero terms and optional bias `b_l`.
+ *
+ *  Instead of the whole K-term formula, the bound of every sum
+ *  is chained from mac_lemma with interval arithmetic in each
+ *  case of precisions, whose domain is read from the background
+ *  facts of node, or the numeral recorded in model:
+ *
+ *    |y_i| <= n * R(px) * R(pw) + m * R(pb) + c
+ *
+ *  where R(p) = 2^(p-1) - 1 is the bit range of precision, and
+ *  n, m, c are the numbers of products, bias and the constant
+ *  terms of y_i. If the bound is within both R(py) and the 64
+ *  bits signed range, so is every partial sum and product, thus
+ *  no operation overflows, the integer and bit-vector semantics
+ *  agree, and `y_i` satisfies its data constraints. Cases whose
+ *  output precision violates [1, 32] are vacuous.
+ *
+ *  Returns one flag per element of y, false means the output
+ *  must be proved by solver.
+ **/
+std::vector<bool> mac_discharge(
+    type::TypePtr const& x, type::TypePtr const& w,
+    type::TypePtr const& b, type::TypePtr const& y,
+    type::z3_expr const& background);
+
+}
+}
+
+#endif // Z3_CVM_DISCHARGE_H
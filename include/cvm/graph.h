@@ -0,0 +1,98 @@
+#ifndef Z3_CVM_GRAPH_H
+#define Z3_CVM_GRAPH_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "node.h"
+
+namespace z3 {
+namespace cvm {
+
+class Params;
+
+/*
+ * Graph of the whole model, loaded from CVM symbol json, which
+ *  is the graph json of nnvm:
+ *
+ *  {
+ *    "nodes": [
+ *      {"op": "null", "name": "data", "inputs": []},
+ *      {"op": "null", "name": "w", "inputs": []},
+ *      {"op": "conv2d", "name": "conv",
+ *       "attrs": {"channels": "4", "kernel_size": "(3, 3)", ...},
+ *       "inputs": [[0, 0, 0], [1, 0, 0]]},
+ *      ...
+ *    ],
+ *    "arg_nodes": [0, 1],
+ *    "node_row_ptr": [0, 1, 2, 3],
+ *    "heads": [[2, 0, 0]],
+ *    "attrs": {
+ *      "shape": ["list_shape", [[1, 4, 8, 8], [4, 4, 3, 3], ...]],
+ *      "precision": ["list_int", [8, 8, ...]]
+ *    }
+ *  }
+ *
+ *  Nodes are in topological order, and the shape and precision
+ *  are indexed by node entry, which is node_row_ptr[nid] plus
+ *  the output index. Variables take the recorded shape and the
+ *  recorded precision, or symbolic precision if it's absent or
+ *  non-positive. Operators are built via the op registry, whose
+ *  attrs are `attrs`, `attr` or `param` of node, and the shapes
+ *  inferred must agree with the recorded ones.
+ *
+ *  With contracts, the graph is verified assume-guarantee: every
+ *  operator output used by another operator is cut into a fresh
+ *  variable of the same data symbols, whose precision is the one
+ *  proven by the producer, see TypeRef::proven_prec. The consumer
+ *  assumes only the contract |y| <= bit_range(prec) of its inputs,
+ *  which the obligations of producer guarantee, so that the cost
+ *  of every node is independent of the upstream cone. Cuts are
+ *  not listed in nodes.
+ *
+ *  With params, variables of a tensor in params file are bound
+ *  to the concrete values, see Constant, instead of symbols, and
+ *  the values must fit in the recorded precision. The products
+ *  with them in dense and conv2d fold to linear terms.
+ **/
+class Graph {
+ public:
+  static std::unique_ptr<Graph> FromJson(const std::string &json,
+                                         bool contracts = false,
+                                         const Params *params = nullptr);
+  static std::unique_ptr<Graph> Load(const std::string &path,
+                                     bool contracts = false,
+                                     const Params *params = nullptr);
+  /*
+   * Visit the nodes of model in topological order without
+   *  keeping the whole graph, every node is built right before
+   *  visited, and released once all of its consumers are
+   *  visited, see Node::release. So the live nodes are bounded
+   *  by the widest frontier of graph instead of all. Nodes are
+   *  allocated in the heap, whose memory is returned on release.
+   **/
+  static void Walk(const std::string &path, bool contracts,
+                   const Params *params,
+                   std::function<void(NodePtr const&)> const& visit);
+
+  ~Graph();
+  Graph(Graph const&) = delete;
+  Graph& operator=(Graph const&) = delete;
+
+  // Nodes in topological order, same as the json.
+  inline std::vector<NodePtr> const& nodes() const { return nodes_; }
+  inline std::vector<NodeEntry> const& heads() const { return heads_; }
+
+ private:
+  Graph() = default;
+
+  std::vector<NodePtr> nodes_;
+  std::vector<NodeEntry> heads_;
+};
+
+}
+}
+
+#endif // Z3_CVM_GRAPH_H
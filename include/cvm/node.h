@@ -2,6 +2,7 @@
 #define Z3_CVM_NODE_H
 
 #include <memory>
+#include <string>
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
@@ -32,11 +33,11 @@ class NodeAssertions {
     unique_id = uid;
     return *this;
   }
-  size_t get_uid() { return unique_id; }
+  size_t get_uid() const { return unique_id; }
 
   NodeAssertions& add_input(type::TypePtr const&);
   NodeAssertions& add_input(type::TypePtr const&, size_t);
-  NodeAssertions& add_input(type::TypePtr const&, std::vector<size_t>);
+  NodeAssertions& add_input(type::TypePtr const&, std::vector<size_t> const&);
   NodeAssertions& add_extra_constraint(type::z3_expr const&);
 
   NodeAssertions& add_output(type::TypePtr const&);
@@ -44,17 +45,60 @@ class NodeAssertions {
 
   NodeAssertions& merge(NodeAssertions const&);
 
+  inline type::z3_expr in_constraints() const {
+    return in_cstr.to_expr();
+  }
+  inline type::z3_expr out_constraints() const {
+    return out_cstr.to_expr();
+  }
+
   type::z3_expr provement_generator() const;
   inline bool operator==(NodeAssertions const& t) const {
     return unique_id == t.unique_id;
   }
 
  private:
-  type::z3_expr in_cstr{true};
-  type::z3_expr out_cstr{true};
+  // Conjuncts are collected and built once per obligation.
+  type::z3_conj in_cstr;
+  type::z3_conj out_cstr;
   size_t unique_id{0};
 };
 
+/*
+ * Cursor over the obligations of node, yields one obligation at
+ *  a time without copying the assertions of node, so that only
+ *  the obligation being proved is alive. Assertions with a uid
+ *  already seen are left out if unique, and the elements of first
+ *  output flagged in skip are left out.
+ *
+ *  The node must outlive the cursor.
+ **/
+class ObligationCursor {
+ public:
+  ObligationCursor(std::vector<std::vector<NodeAssertions> > const& nas,
+                   bool unique, std::vector<bool> const& skip);
+
+  // Returns false when all the obligations are yielded.
+  bool next(type::z3_expr *obligation);
+
+ private:
+  std::vector<std::vector<NodeAssertions> > const& nas_;
+  std::vector<bool> skip_;
+  std::unordered_set<size_t> uid_set_;
+  bool unique_;
+  size_t output_{0};
+  size_t index_{0};
+};
+
+/*
+ * Verdict of counterexample replayed on the concrete executor,
+ *  see Node::replay.
+ **/
+struct ReplayVerdict {
+  bool confirmed{false};
+  std::string detail;
+};
+
 class Node {
  public:
   NodeAttrs attrs;
@@ -63,7 +107,7 @@ class Node {
   Node() = default;
   ~Node();
   static NodePtr Create() {
-    return std::make_shared<Node>(Node());
+    return std::make_shared<Node>();
   }
 
   inline const Op* op() const;
@@ -76,13 +120,70 @@ class Node {
   inline void setup() {
     if (op() == nullptr) return ;
 
+    type::SimplifyScope scope(op()->simplify_level);
     infer_shape();
     infer_precision();
     forward();
   }
 
+  /*
+   * Obligations of node, the elements of first output flagged
+   *  in skip are left out, such as the ones closed by
+   *  compositional_discharge.
+   **/
   std::vector<type::z3_expr> 
-  provements_generator(bool unique = true);
+  provements_generator(bool unique = true,
+                       std::vector<bool> const& skip = {});
+  // Streaming version of provements_generator.
+  ObligationCursor obligations(bool unique = true,
+                               std::vector<bool> const& skip = {}) const;
+  /*
+   * Flags of the first output's elements discharged by the
+   *  compositional rule of operator, empty if not registered.
+   **/
+  std::vector<bool> compositional_discharge();
+  /*
+   * Background constraints shared by all the obligations of
+   *  node, contains the precision domains of inputs and outputs
+   *  and the constraints collected in infer_precision, which is
+   *  asserted once in an incremental ProveSession.
+   **/
+  type::z3_expr background();
+  /*
+   * Signature of node verification: operator name, attributes
+   *  in canonical form, and shape and precision of every input.
+   *  Numeral precision is kept, symbolic one is only bounded in
+   *  [1, 32] and is named by the first input sharing the symbol,
+   *  so are the data tensors. Constant data bound from params
+   *  are named by the param tensor, other numerals are kept by
+   *  the values. Nodes of equal signature have the same
+   *  obligations up to renaming of symbols, and so the same
+   *  verdicts.
+   **/
+  std::string signature();
+  /*
+   * Release the inputs, the output tensors and the assertions of
+   *  node, which hold the per-element expressions. Only attrs is
+   *  kept, it's invoked when the node and its consumers are all
+   *  verified, see Graph::Walk.
+   **/
+  void release();
+
+  /*
+   * Replay the counterexample m of node's obligation on the
+   *  concrete executor of operator. The inputs and precisions
+   *  are evaluated in m, and the overflow is confirmed if the
+   *  inputs lie in their precision domains, and the execution
+   *  faults or some output exceeds its precision.
+   **/
+  ReplayVerdict replay(model const& m);
+  /*
+   * Differential test of forward function against the concrete
+   *  executor of operator, the outputs evaluated in m are
+   *  compared with the concrete outputs of the inputs evaluated
+   *  in m. Returns the first mismatch, empty if all equal.
+   **/
+  std::string differential(model const& m);
 
   template<typename ValueType = type::TypeRef, typename ...Args>
   static NodeEntry CreateVariable(
@@ -100,8 +201,19 @@ class Node {
   friend class NodeEntry;
   std::vector<type::TypePtr> data_;
   std::vector<std::vector<NodeAssertions> > nas_;
+  std::vector<NodeAssertions> shared_nas_;
 
   void forward();
+  /*
+   * Concrete inputs of node evaluated in m, false with the
+   *  reason in detail if the operator has no concrete executor.
+   **/
+  bool concrete_inputs(model const& m,
+                       std::vector<ConcreteTensor> *inputs,
+                       std::string *detail);
+  std::vector<ConcreteTensor> execute(
+      std::vector<ConcreteTensor> const& inputs,
+      ConcreteFaults &faults);
   void infer_shape();
   void infer_precision();
 };
@@ -167,13 +279,12 @@ NodeEntry Node::CreateVariable(
   n->data_.emplace_back(ValueType::Make(
         node_name,
         std::forward<Args>(args)...));
-  for (size_t i = 0; i < n->data_[0]->Size(); ++i) {
-    n->nas_.emplace_back(
-      std::vector<NodeAssertions>{
-        NodeAssertions()
-          .add_input(n->data_[0], i)
-          .add_output(n->data_[0], i)
-    });
+  n->nas_.resize(n->data_[0]->Size());
+  for (size_t i = 0; i < n->nas_.size(); ++i) {
+    n->nas_[i].emplace_back();
+    n->nas_[i].back()
+      .add_input(n->data_[0], i)
+      .add_output(n->data_[0], i);
   }
   return NodeEntry{n, 0, 0};
 }
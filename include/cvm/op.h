@@ -8,6 +8,7 @@
 
 #include "base.h"
 #include "z3_types.h"
+#include "concrete.h"
 #include "registry.h"
 
 namespace z3 {
@@ -34,6 +35,21 @@ class Op {
   uint32_t num_inputs = 1;
   uint32_t num_outputs = 1;
 
+  // Semantic version, part of the ProofCache key.
+  uint32_t version = 0;
+  inline Op& set_version(uint32_t v) {
+    this->version = v;
+    return *this;
+  }
+
+  // Simplify level of the operator's constraints and
+  //  obligations, negative value follows the global level.
+  int simplify_level = -1;
+  inline Op& set_simplify_level(int level) {
+    this->simplify_level = level;
+    return *this;
+  }
+
   using FNumOutputs = 
   std::function<uint32_t(const NodeAttrs& attrs)>;
   FNumOutputs get_num_outputs = nullptr;
@@ -96,6 +112,39 @@ class Op {
     return *this;
   }
 
+  /*
+   * Compositional rule of operator, returns the flags of the
+   *  outputs[0] elements discharged without solver under the
+   *  background of node, see `mac_discharge`.
+   **/
+  using FCompositional = std::function<std::vector<bool>(
+      NodeAttrs const& attrs,
+      std::vector<type::TypePtr> const& inputs,
+      std::vector<type::TypePtr> const& outputs,
+      type::z3_expr const& background)>;
+  FCompositional compositional = nullptr;
+  inline Op& set_compositional(FCompositional const& fn) {
+    this->compositional = fn;
+    return *this;
+  }
+
+  /*
+   * Concrete executor of operator in int64, the outputs are
+   *  sized by the inferred shapes before invoked. The operator
+   *  constraints violated on the way are recorded into faults,
+   *  see `Node::replay` and `Node::differential`.
+   **/
+  using FConcrete = std::function<void(
+      NodeAttrs const& attrs,
+      std::vector<ConcreteTensor> const& inputs,
+      std::vector<ConcreteTensor>& outputs,
+      ConcreteFaults& faults)>;
+  FConcrete concrete = nullptr;
+  inline Op& set_concrete(FConcrete const& fn) {
+    this->concrete = fn;
+    return *this;
+  }
+
   func_pg provements_generator = nullptr;
   inline Op& set_generator(func_pg const& func) {
     this->provements_generator = func;
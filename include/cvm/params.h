@@ -0,0 +1,73 @@
+#ifndef Z3_CVM_PARAMS_H
+#define Z3_CVM_PARAMS_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include "z3_types.h"
+
+namespace z3 {
+namespace cvm {
+
+/*
+ * Tensor of params file, the data points into the mapped file
+ *  without copy, and is valid as long as the params.
+ **/
+struct ParamTensor {
+  type::Shape shape;
+  // Bits of signed integer element, 8, 16, 32 or 64.
+  int bits;
+  const char *data;
+
+  int64_t at(size_t index) const;
+};
+
+/*
+ * Params is a read-only view of the CVM params file, which is
+ *  the ndarray list of tvm:
+ *
+ *  uint64 magic, uint64 reserved,
+ *  uint64 num_names, { uint64 length, char name[length] } ...,
+ *  uint64 num_arrays, {
+ *    uint64 magic, uint64 reserved,
+ *    int32 device_type, int32 device_id,
+ *    int32 ndim, uint8 code, uint8 bits, uint16 lanes,
+ *    int64 shape[ndim], int64 num_bytes, data[num_bytes]
+ *  } ...
+ *
+ *  The file is memory-mapped at open and only the offsets of
+ *  tensors are indexed by name, the `arg:` prefix of name is
+ *  removed. Only integer tensors of single lane are accepted.
+ **/
+class Params {
+ public:
+  explicit Params(const std::string &path);
+  ~Params();
+
+  Params(const Params&) = delete;
+  Params& operator=(const Params&) = delete;
+
+  // nullptr if there is no tensor of the name.
+  const ParamTensor* find(const std::string &name) const;
+
+  inline const std::string& path() const { return path_; }
+  inline size_t size() const { return index_.size(); }
+
+ private:
+  void load();
+  // Unmap and close the file, safe to call twice.
+  void release();
+
+  std::string path_;
+  int fd_{-1};
+  const char *map_{nullptr};
+  size_t map_size_{0};
+
+  std::unordered_map<std::string, ParamTensor> index_;
+};
+
+}
+}
+
+#endif // Z3_CVM_PARAMS_H
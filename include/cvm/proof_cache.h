@@ -0,0 +1,83 @@
+#ifndef Z3_CVM_PROOF_CACHE_H
+#define Z3_CVM_PROOF_CACHE_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "op.h"
+#include "prover.h"
+
+namespace z3 {
+namespace cvm {
+
+/*
+ * Key of obligation in ProofCache. The hash indexes the record,
+ *  and the check, an independent hash of the same obligation,
+ *  confirms the hit, so that a collision of the 64-bit hash is
+ *  not taken as proof.
+ **/
+struct ProofKey {
+  uint64_t hash{0};
+  uint64_t check{0};
+};
+
+/*
+ * ProofCache is a persistent, append-only verdict store.
+ *
+ *  The key is the stable hash of obligation combined with an
+ *  operator tag, see `Op::set_version`, and is confirmed by the
+ *  check hash stored in record; the value is verdict,
+ *  solve time and the optional counterexample. Existing records
+ *  are memory-mapped read-only at open and indexed by key, new
+ *  verdicts are appended to the end of file with one write per
+ *  record, so that a torn tail left by crash is truncated at
+ *  next open, and the valid prefix is kept.
+ *
+ *  Only definitive verdicts are stored, unknown results may
+ *  turn into proof with more resources.
+ **/
+class ProofCache {
+ public:
+  explicit ProofCache(const std::string &path);
+  ~ProofCache();
+
+  ProofCache(const ProofCache&) = delete;
+  ProofCache& operator=(const ProofCache&) = delete;
+
+  /*
+   * Tag of operator semantic, which mixes the operator name and
+   *  version. Bump version when a change is not visible from
+   *  the generated formulas, such as the generator semantic.
+   **/
+  static uint64_t OpTag(const Op *op);
+  // Seed of the check hash, see structural_hash.
+  static constexpr uint64_t kCheckSeed = 0x9E3779B97F4A7C15ULL;
+
+  // False if absent, or the check of record differs.
+  bool find(ProofKey const& key, ProveResult *res) const;
+  void insert(ProofKey const& key, ProveResult const& res);
+
+  inline const std::string& path() const { return path_; }
+  size_t size() const;
+
+ private:
+  std::string path_;
+  int fd_{-1};
+  const char *map_{nullptr};
+  size_t map_size_{0};
+
+  // Offset of record in mapped file.
+  std::unordered_map<uint64_t, size_t> index_;
+  // Records appended after open, with the check.
+  std::unordered_map<uint64_t, std::pair<uint64_t, ProveResult> >
+    appended_;
+  mutable std::mutex mutex_;
+};
+
+}
+}
+
+#endif // Z3_CVM_PROOF_CACHE_H
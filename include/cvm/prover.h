@@ -0,0 +1,364 @@
+#ifndef Z3_CVM_PROVER_H
+#define Z3_CVM_PROVER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "z3++.h"
+#include "z3_types.h"
+
+namespace z3 {
+namespace cvm {
+
+class Op;
+class ProofCache;
+class ObligationCursor;
+
+enum class ProveStatus {
+  // unsat, the obligation holds for all inputs.
+  kDeterministic,
+  // sat, the model is a counterexample.
+  kUndeterministic,
+  // unknown, solver gives up.
+  kUnprovable,
+};
+
+/*
+ * One step of escalation ladder. The obligation is checked by
+ *  the steps in order until a definitive verdict, and each step
+ *  has its own budget, so that a hard obligation gives up as
+ *  unprovable instead of holding up the rest of sweep.
+ **/
+struct ProveStep {
+  std::string name;
+  // Wall time budget in milliseconds, zero means unlimited.
+  unsigned timeout{0};
+  // Resource budget of z3, which is deterministic across
+  //  machines unlike timeout, zero means unlimited.
+  unsigned rlimit{0};
+  // Tactics combined with and-then, separated by ';', such as
+  //  "simplify;bit-blast;sat". Empty means the default solver.
+  std::string tactic;
+  // Check each conjunct of the consequent separately.
+  bool split{false};
+};
+using ProveLadder = std::vector<ProveStep>;
+
+/*
+ * Quick check, tactic retry, decomposition and final attempt
+ *  with the whole budget. Empty ladder is returned if both
+ *  budgets are zero, which checks once without any limit.
+ **/
+ProveLadder default_ladder(unsigned timeout, unsigned rlimit);
+
+struct ProveAttempt {
+  std::string step;
+  ProveStatus status;
+  double time;
+  // Reason of unknown, such as timeout.
+  std::string reason;
+};
+
+/*
+ * Value of constant in counterexample, which is plain data, so
+ *  that the model of worker context can be rebuilt in another
+ *  context, see ProveResult::rebuild.
+ **/
+struct ModelValue {
+  // Int symbol of SymbolTable, or else the string name.
+  bool int_symbol{false};
+  int number{0};
+  std::string name;
+  Z3_sort_kind kind{Z3_UNKNOWN_SORT};
+  unsigned bv_size{0};
+  // Numeral in decimal, or `true` and `false`.
+  std::string value;
+};
+
+struct ProveResult {
+  ProveStatus status{ProveStatus::kUnprovable};
+  // Wall time of solver check in seconds.
+  double time{0};
+  // Solver assertions dumped before checking.
+  std::string smt;
+  // Counterexample, only set with kUndeterministic status.
+  std::string model;
+  // Constants of counterexample, empty if only the text is kept,
+  //  such as the verdict of proof cache.
+  std::vector<ModelValue> values;
+  // Index of the obligation whose verdict is shared, equals
+  //  with the index of itself unless deduplicated.
+  size_t representative{0};
+  // Which pass discharges the obligation: z3, syntactic,
+  //  interval, canonical or cache.
+  std::string method{"z3"};
+  // Steps of escalation ladder tried, or strategies raced in
+  //  portfolio, empty otherwise.
+  std::vector<ProveAttempt> attempts;
+  // Strategy which wins the portfolio race.
+  std::string strategy;
+
+  /*
+   * Print the result in the same layout as the sequential
+   *  z3_prover used in test records.
+   **/
+  void report(std::ostream &os) const;
+  /*
+   * Rebuild the counterexample in ctx, such as the global one
+   *  to replay the verdict of worker, false without values.
+   **/
+  bool rebuild(context &ctx, z3::model *m) const;
+};
+
+/*
+ * ProveSession checks sibling obligations in one incremental
+ *  solver. The shared background, such as input precision
+ *  domains, is asserted once at base level, and each obligation
+ *  is checked within push/pop scope, so that learned clauses
+ *  and bit-blasted circuits of the background are reused.
+ **/
+class ProveSession {
+ public:
+  ProveSession(context &ctx, expr const& background,
+               ProveLadder const& ladder = {});
+
+  ProveResult prove(expr const& cstr);
+
+ private:
+  solver solver_;
+  expr background_;
+  ProveLadder ladder_;
+};
+
+/*
+ * Portfolio races strategies on one obligation, such as bit-blast
+ *  with sat, qfbv and smt with arithmetic preprocessing, whose
+ *  running time varies by orders of magnitude on nonlinear
+ *  bit-vector obligations.
+ *
+ *  Every strategy owns a private context and runs in its own
+ *  thread. The first definitive verdict wins and the others
+ *  are interrupted. The split flag of strategy is ignored.
+ **/
+class Portfolio {
+ public:
+  explicit Portfolio(ProveLadder const& strategies);
+  ~Portfolio();
+
+  Portfolio(const Portfolio&) = delete;
+  Portfolio& operator=(const Portfolio&) = delete;
+
+  inline ProveLadder const& strategies() const { return strategies_; }
+
+  /*
+   * Obligation and background are translated from ctx, which
+   *  must not be accessed by other threads meanwhile.
+   **/
+  ProveResult prove(context &ctx, expr const& background,
+                    expr const& cstr);
+
+ private:
+  ProveLadder strategies_;
+  std::vector<std::unique_ptr<context> > contexts_;
+};
+
+ProveLadder default_portfolio(unsigned timeout, unsigned rlimit);
+
+/*
+ * Prover checks a batch of obligations concurrently with
+ *  a pool of worker threads.
+ *
+ * Z3 context is not thread-safe, so every worker owns a private
+ *  z3::context. Obligations are built in the global Z3Context(),
+ *  translated into the worker context under Z3ContextMutex(),
+ *  and then checked without holding any lock.
+ **/
+class Prover {
+ public:
+  // Zero number of workers means hardware concurrency.
+  explicit Prover(size_t num_workers = 0);
+  ~Prover();
+
+  Prover(const Prover&) = delete;
+  Prover& operator=(const Prover&) = delete;
+
+  inline size_t num_workers() const { return workers_.size(); }
+
+  /*
+   * Deduplicate obligations by alpha-canonical form, only one
+   *  representative per class is checked by z3, and the verdict
+   *  fans out to all the members. Obligations under a shared
+   *  background are not deduplicated.
+   **/
+  inline Prover& set_canonical(bool flag) {
+    this->canonical_ = flag;
+    return *this;
+  }
+
+  /*
+   * Close data-movement obligations without solver, see
+   *  `syntactic_discharge`.
+   **/
+  inline Prover& set_syntactic(bool flag) {
+    this->syntactic_ = flag;
+    return *this;
+  }
+
+  /*
+   * Close range obligations without solver, see
+   *  `interval_discharge`.
+   **/
+  inline Prover& set_interval(bool flag) {
+    this->interval_ = flag;
+    return *this;
+  }
+
+  /*
+   * Check obligations over the smallest sound bit-vector width,
+   *  see `narrow_width`. Counterexample of a narrowed obligation
+   *  is confirmed with the original one. Only obligations
+   *  without background are narrowed.
+   **/
+  inline Prover& set_adaptive_width(bool flag) {
+    this->adaptive_width_ = flag;
+    return *this;
+  }
+
+  /*
+   * Budget and escalation steps of every obligation.
+   **/
+  inline Prover& set_ladder(ProveLadder const& ladder) {
+    this->ladder_ = ladder;
+    return *this;
+  }
+
+  /*
+   * Race the strategies on every obligation instead of the
+   *  escalation ladder, empty strategies disable portfolio.
+   **/
+  Prover& set_portfolio(ProveLadder const& strategies);
+  /*
+   * Number of wins of every strategy, grouped by operator name.
+   **/
+  inline std::map<std::string, std::map<std::string, size_t> > const&
+  portfolio_wins() const {
+    return portfolio_wins_;
+  }
+
+  /*
+   * Look up verdicts in the persistent cache before building
+   *  any solver, and record the new verdicts. The cache is
+   *  not owned by prover.
+   **/
+  inline Prover& set_cache(ProofCache *cache) {
+    this->cache_ = cache;
+    return *this;
+  }
+
+  /*
+   * Check all the obligations and return results in the same
+   *  order. The caller must not touch the global context until
+   *  prove returns.
+   **/
+  std::vector<ProveResult> prove(
+      std::vector<type::z3_expr> const& proves);
+  /*
+   * Check the obligations with one ProveSession per worker,
+   *  which shares the background constraints. The operator
+   *  owns the obligations, whose tag is mixed into the cache
+   *  key, and whose name groups the portfolio statistics.
+   **/
+  std::vector<ProveResult> prove(
+      std::vector<type::z3_expr> const& proves,
+      type::z3_expr const& background,
+      const Op *op = nullptr);
+  /*
+   * Pipelined prove, the calling thread builds obligations from
+   *  the cursor and feeds them into a bounded queue, which the
+   *  workers drain meanwhile. Building and solving overlap, and
+   *  at most capacity obligations are in flight.
+   *
+   *  Results are passed to report in the order of obligations,
+   *  as soon as all the previous ones are checked. Syntactic and
+   *  interval passes are applied by the calling thread, while
+   *  canonical, adaptive width and cache need the whole batch
+   *  and are not applied. Returns the number of obligations.
+   **/
+  size_t prove_stream(
+      ObligationCursor &cursor,
+      type::z3_expr const& background,
+      std::function<void(ProveResult const&)> const& report,
+      const Op *op = nullptr,
+      size_t capacity = 64);
+
+ private:
+  struct Worker {
+    context ctx;
+    std::thread thread;
+    std::unique_ptr<Portfolio> portfolio;
+    uint64_t portfolio_version{0};
+  };
+  // Solver state of worker within one generation.
+  struct WorkerState {
+    std::unique_ptr<ProveSession> session;
+    expr background;
+    bool has_background{false};
+    explicit WorkerState(context &ctx) : background(ctx) {}
+  };
+  struct Stream;
+
+  void run(Worker *w);
+  // Translate the obligation into worker, under Z3ContextMutex.
+  expr translate(Worker *w, WorkerState *s, expr const& cstr);
+  ProveResult check(Worker *w, WorkerState *s, expr const& cstr);
+  void drain(Worker *w, WorkerState *s);
+  std::vector<ProveResult> dispatch(
+      std::vector<type::z3_expr> const& proves,
+      type::z3_expr const& background);
+
+  bool canonical_{false};
+  bool syntactic_{false};
+  bool interval_{false};
+  bool adaptive_width_{false};
+  ProveLadder ladder_;
+  ProveLadder portfolio_;
+  uint64_t portfolio_version_{0};
+  std::map<std::string, std::map<std::string, size_t> > portfolio_wins_;
+  ProofCache *cache_{nullptr};
+
+  std::vector<std::unique_ptr<Worker> > workers_;
+
+  std::mutex mutex_;
+  std::condition_variable task_cv_;
+  std::condition_variable done_cv_;
+  bool stop_{false};
+  uint64_t generation_{0};
+  size_t active_{0};
+
+  std::vector<type::z3_expr> const* batch_{nullptr};
+  type::z3_expr const* background_{nullptr};
+  std::vector<ProveResult> *results_{nullptr};
+  std::atomic<size_t> next_{0};
+  // Queues of prove_stream, nullptr for batch.
+  Stream *stream_{nullptr};
+};
+
+/*
+ * Check single obligation in the given context, which is
+ *  the worker routine of Prover.
+ **/
+ProveResult prove_in_context(context &ctx, expr const& cstr,
+                             ProveLadder const& ladder = {});
+
+}
+}
+
+#endif // Z3_CVM_PROVER_H
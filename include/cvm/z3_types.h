@@ -5,6 +5,10 @@
 #include <memory>
 #include <exception>
 #include <cmath>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
 
 #include "z3++.h"
 #include "base.h"
@@ -18,6 +22,124 @@ using TypePtr = std::shared_ptr<TypeRef>;
 context& Z3Context();
 #define C Z3Context()
 
+/*
+ * Z3 context is not thread-safe, any thread accessing the
+ *  global context concurrently, such as translating obligations
+ *  into a worker context, must hold the mutex.
+ **/
+std::mutex& Z3ContextMutex();
+
+/*
+ * Helper function declarations are built once per context,
+ *  InitContext declares them ahead of translation into the
+ *  context, and ReleaseContext must be invoked before the
+ *  context is destroyed.
+ **/
+void InitContext(context &ctx);
+void ReleaseContext(context &ctx);
+
+/*
+ * Theory of data representation, bit-vector of 64 bits by
+ *  default, or mathematical integer whose operator constraints
+ *  bound every result into the range of 64 bits, so that both
+ *  theories agree on the obligations. Linear and range style
+ *  obligations are often faster in integer arithmetic than
+ *  bit-blasting.
+ *
+ * The theory must be set before any data is built, expressions
+ *  of different theories can't be mixed. Prefer the resource
+ *  limit to timeout with integer theory, z3 may miss the timer
+ *  in nonlinear arithmetic.
+ **/
+enum class Theory { kBitVector, kInteger };
+void SetTheory(Theory theory);
+Theory GetTheory();
+
+/*
+ * Simplify level of the constraints built and checked, see
+ *  SIMPLIFY_LEVEL in base.h, which is the default value. The
+ *  level can be changed at runtime, and is shared by all the
+ *  threads, data built with different levels can be mixed.
+ **/
+void SetSimplifyLevel(int level);
+int GetSimplifyLevel();
+
+/*
+ * Simplification of constraints is memoized, which keeps the
+ *  constraints alive. Clear it when the data built are released,
+ *  so that their asts are freed.
+ **/
+void ClearSimplifyMemo();
+
+/*
+ * Override the simplify level until the scope exits, negative
+ *  level keeps the current one, such as operator without
+ *  level of its own.
+ **/
+class SimplifyScope {
+ public:
+  explicit SimplifyScope(int level);
+  ~SimplifyScope();
+  SimplifyScope(SimplifyScope const&) = delete;
+  SimplifyScope& operator=(SimplifyScope const&) = delete;
+
+ private:
+  int prev_;
+};
+
+/*
+ * Shape of accumulation trees of operators such as dense, conv2d
+ *  and sum. Linear chain of K additions carries the overflow
+ *  constraints of every partial sum, which include all of the
+ *  previous ones, while balanced tree keeps the depth and the
+ *  constraints in O(log K). Both are equal in value.
+ **/
+enum class ReduceMode { kLinear, kTree };
+void SetReduceMode(ReduceMode mode);
+ReduceMode GetReduceMode();
+
+/*
+ * Data symbols of tensors are z3 integer symbols instead of
+ *  string names, so that no name is formatted nor hashed into
+ *  the symbol table of z3 when building the graph. The ids of
+ *  a tensor name are reserved in contiguous blocks, and the
+ *  element symbol is the base of block plus the flat index.
+ *
+ *  The element of the same name and index is always the same
+ *  symbol, as string names did, so that the asts and the
+ *  simplification memo are reused across graphs. The readable
+ *  name `name_index` is only produced by name(), such as when
+ *  a counterexample is printed.
+ **/
+class SymbolTable {
+ public:
+  // Ids of flat index [start, start + size) are [base, base + size).
+  struct Block {
+    int base;
+    size_t start;
+    size_t size;
+  };
+
+  static SymbolTable* Get();
+
+  /*
+   * Blocks of tensor name covering flat index [0, size), a new
+   *  block is reserved for the indexes beyond the previous ones.
+   *  Returns empty if the ids of z3 integer symbols, which are
+   *  in range [0, 2^30), are used up.
+   **/
+  std::vector<Block> reserve(const std::string &name, size_t size);
+  // Readable name of symbol, string symbol is returned as is.
+  std::string name(symbol const& s);
+
+ private:
+  std::mutex mutex_;
+  int next_{0};
+  std::unordered_map<std::string, std::vector<Block> > blocks_;
+  // Tensor name and block, indexed by the base.
+  std::map<int, std::pair<std::string, Block> > names_;
+};
+
 #define CONCAT_(a, b) a ## b
 #define CONCAT(a, b) CONCAT_(a, b)
 
@@ -143,6 +265,35 @@ F_Z3_EXPR_DECL(operator==, 2);
 F_Z3_EXPR_DECL(operator&&, 2);
 F_Z3_EXPR_DECL(implies, 2);
 
+/*
+ * Accumulator of conjunction. Chain of binary `&&` builds a
+ *  left-nested tree, which is simplified from the root at every
+ *  step with higher simplify level, and costs quadratic time in
+ *  the number of conjuncts.
+ *
+ * The accumulator flattens nested conjunctions into one list,
+ *  drops the conjuncts simplified into true, and builds a single
+ *  n-ary `and` of the distinct conjuncts in insertion order.
+ *  Only the constraints of z3_expr are collected.
+ **/
+class z3_conj {
+ public:
+  z3_conj& add(z3_cstr const& c);
+  inline z3_conj& add(z3_expr const& e) { return add(e.cstr); }
+  z3_conj& add(z3_conj const& t);
+
+  inline bool empty() const {
+    return !false_ && conjuncts_.empty();
+  }
+
+  z3_cstr build() const;
+  inline z3_expr to_expr() const { return z3_expr(build()); }
+
+ private:
+  std::vector<expr> conjuncts_;
+  bool false_{false};
+};
+
 // typedef std::vector<int32_t> Shape;
 typedef std::vector<int32_t> _ShapeBase;
 class Shape : public _ShapeBase {
@@ -252,6 +403,26 @@ class TypeRef {
    **/
   z3_expr assign_constraints();
   z3_expr assign_constraints(size_t index);
+  // Assign constraints of precision only.
+  z3_expr prec_assign_constraints();
+  /*
+   * Precision guaranteed by the obligations of type, which is the
+   *  value assigned to precision if it simplifies to a numeral,
+   *  or else the precision symbol itself.
+   **/
+  z3_expr proven_prec() const;
+  /*
+   * Value assigned to the element of index, or to precision if
+   *  index equals with data.size(), the symbol itself if not
+   *  assigned.
+   **/
+  z3_expr const& assigned(size_t index) const;
+  /*
+   * TypeRef range constraints bound the precision's bit range,
+   *  which is the shared sub-expression of all data constraints.
+   *  It's implied by precision constraints.
+   **/
+  z3_expr range_constraints();
   static z3_expr collect_constraints(std::vector<TypePtr> trs);
 
   z3_expr deterministic();
@@ -273,6 +444,14 @@ class TypeRef {
   // assign constructor is deleted.
   TypeRef& operator=(const TypePtr &t) = delete;
 
+  // Only constructible via Make, which builds in place.
+  class MakeKey {
+    friend class TypeRef;
+    MakeKey() {}
+  };
+  TypeRef(MakeKey, std::vector<z3_expr> &&data,
+          const z3_expr &prec, const Shape &shp);
+
  protected:
   std::vector<z3_expr> data;
   /*
@@ -282,23 +461,27 @@ class TypeRef {
    *  the deterministic of model directed acyclic graph.
    *
    * Assign constraints is recursive collected.
+   *
+   * Constraints are kept as recipes: the values set by set_data
+   *  and set_prec, whose last slot is the precision. The assign
+   *  constraint `data == value` and the operator assertions of
+   *  value only become z3 asts when an obligation using the
+   *  index is emitted, and slots never assigned take no ast.
    **/
-  std::vector<z3_expr> assign_constraints_;
-  std::vector<z3_expr> operator_assertions_;
-
-  inline TypeRef(
-      const std::vector<z3_expr> &data,
-      const z3_expr &prec, 
-      const Shape &shp) : 
-      data(data), prec(prec), shape(shp) {
-    VERIFY_EQ(shp.Size(), data.size())
-      << "TypeRef initializing with non consistent "
-      << "shape & data size "
-      << shp.to_string() << "==" << shp.Size()
-      << " vs. " << data.size();
-    assign_constraints_.resize(shp.Size() + 1, z3_expr(true));
-    operator_assertions_.resize(shp.Size() + 1, z3_expr(true));
-  }
+  std::vector<z3_expr> values_;
+  std::vector<bool> assigned_;
+
+  // Bit range of precision, shared by all data constraints.
+  z3_expr const& bit_range();
+  z3_expr assign_constraint(size_t index) const;
+  z3_expr operator_assertion(size_t index) const;
+
+  // Memo of whole tensor conjunctions, reset by assignment.
+  struct Memo {
+    bool valid{false};
+    z3_expr value{true};
+  };
+  Memo range_memo_, data_memo_, op_memo_, assign_memo_;
 };
 
 /*
@@ -321,6 +504,22 @@ class Scalar final : public TypeRef {
   }
 };
 
+/*
+ * Constant tensor of concrete values, such as the weights bound
+ *  from params file. The data are numerals instead of symbols,
+ *  so that the arithmetic with them folds before checking, the
+ *  name is only for the variable node.
+ **/
+class Constant final : public TypeRef {
+ public:
+  static TypePtr Make(const std::string &name,
+                      const Shape &shape,
+                      const z3_expr &prec,
+                      const std::vector<z3_expr> &values) {
+    return TypeRef::Make(values, prec, shape);
+  }
+};
+
 }
 }
 
@@ -0,0 +1,115 @@
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "z3++.h"
+
+#include "cvm/canonical.h"
+
+namespace z3 {
+namespace cvm {
+
+using namespace type;
+
+static inline bool is_symbol(expr const& t) {
+  return t.is_app() && t.num_args() == 0 &&
+    t.decl().decl_kind() == Z3_OP_UNINTERPRETED;
+}
+
+CanonicalForm::CanonicalForm(expr const& e) : form_(e) {
+  context &ctx = e.ctx();
+  expr_vector src(ctx), dst(ctx);
+  std::unordered_set<unsigned> visited;
+  // Explicit stack to avoid stack overflow of deep expression,
+  //  children are pushed reversely for left-to-right order.
+  std::vector<expr> stack{e};
+  while (!stack.empty()) {
+    expr t = stack.back();
+    stack.pop_back();
+    if (!t.is_app() || !visited.insert(t.id()).second) continue;
+
+    if (is_symbol(t)) {
+      std::string name = "!c" + std::to_string(src.size());
+      src.push_back(t);
+      dst.push_back(ctx.constant(name.c_str(), t.get_sort()));
+      continue;
+    }
+    for (unsigned i = t.num_args(); i > 0; --i) {
+      stack.push_back(t.arg(i - 1));
+    }
+  }
+  num_symbols_ = src.size();
+  if (num_symbols_ > 0) form_ = form_.substitute(src, dst);
+}
+
+uint64_t hash_bytes(const void *data, size_t size, uint64_t seed) {
+  const unsigned char *p = static_cast<const unsigned char*>(data);
+  uint64_t h = seed;
+  for (size_t i = 0; i < size; ++i) {
+    h ^= p[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+static inline uint64_t hash_string(uint64_t seed, std::string const& s) {
+  return hash_bytes(s.data(), s.size(), hash_combine(seed, s.size()));
+}
+
+uint64_t structural_hash(expr const& e, uint64_t seed) {
+  // Post-order traversal with memoization by ast id, every
+  //  node hash covers declaration name, sort and children.
+  std::unordered_map<unsigned, uint64_t> memo;
+  std::vector<std::pair<expr, bool> > stack{{e, false}};
+  while (!stack.empty()) {
+    expr t = stack.back().first;
+    bool expanded = stack.back().second;
+    stack.pop_back();
+    if (memo.count(t.id())) continue;
+    if (!t.is_app()) {
+      memo[t.id()] = hash_string(seed, t.to_string());
+      continue;
+    }
+    if (!expanded) {
+      stack.emplace_back(t, true);
+      for (unsigned i = t.num_args(); i > 0; --i) {
+        stack.emplace_back(t.arg(i - 1), false);
+      }
+      continue;
+    }
+
+    // Symbols of SymbolTable are int symbols, which have no string.
+    symbol name = t.decl().name();
+    uint64_t h = hash_combine(seed, name.kind());
+    h = name.kind() == Z3_INT_SYMBOL ?
+      hash_combine(h, name.to_int()) : hash_string(h, name.str());
+    sort s = t.get_sort();
+    h = hash_combine(h, s.sort_kind());
+    if (s.is_bv()) h = hash_combine(h, s.bv_size());
+    if (t.is_numeral()) h = hash_string(h, t.get_decimal_string(0));
+    for (unsigned i = 0; i < t.num_args(); ++i) {
+      h = hash_combine(h, memo.at(t.arg(i).id()));
+    }
+    memo[t.id()] = h;
+  }
+  return memo.at(e.id());
+}
+
+std::vector<size_t> canonical_classes(
+    std::vector<z3_expr> const& proves) {
+  std::vector<size_t> reps(proves.size());
+  std::unordered_map<unsigned, size_t> index;
+  // Hold the canonical forms, since ast id may be recycled
+  //  after the ast is released.
+  std::vector<CanonicalForm> forms;
+  for (size_t i = 0; i < proves.size(); ++i) {
+    CanonicalForm f(proves[i].cstr);
+    auto it = index.emplace(f.id(), i);
+    reps[i] = it.first->second;
+    if (it.second) forms.push_back(f);
+  }
+  return reps;
+}
+
+}
+}
@@ -0,0 +1,324 @@
+#include <algorithm>
+#include <map>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "z3++.h"
+
+#include "cvm/discharge.h"
+
+namespace z3 {
+namespace cvm {
+
+using namespace type;
+using int128 = __int128;
+
+static const int128 kInt64Max = std::numeric_limits<int64_t>::max();
+// Precision symbols are bounded in [1, 32], see prec_constraints.
+static const int64_t kMaxPrecision = 32;
+
+bool mac_lemma() {
+  static const bool proved = []() {
+    context ctx;
+    expr x = ctx.int_const("x"), w = ctx.int_const("w");
+    expr rx = ctx.int_const("rx"), rw = ctx.int_const("rw");
+    expr s = ctx.int_const("s"), bs = ctx.int_const("bs");
+    expr t = ctx.int_const("t"), bt = ctx.int_const("bt");
+    expr product = implies(
+        rx >= 0 && rw >= 0 && -rx <= x && x <= rx && -rw <= w && w <= rw,
+        -(rx * rw) <= x * w && x * w <= rx * rw);
+    expr accumulate = implies(
+        bs >= 0 && bt >= 0 && -bs <= s && s <= bs && -bt <= t && t <= bt,
+        -(bs + bt) <= s + t && s + t <= bs + bt);
+    solver sv(ctx);
+    params p(ctx);
+    p.set("rlimit", 100000000u);
+    sv.set(p);
+    sv.add(!(product && accumulate));
+    return sv.check() == unsat;
+  }();
+  return proved;
+}
+
+static bool int_numeral(expr const& e, int64_t *v) {
+  if (!e.is_numeral()) return false;
+  if (e.is_bv()) {
+    uint64_t u;
+    if (e.get_sort().bv_size() != 64 || !e.is_numeral_u64(u)) return false;
+    *v = static_cast<int64_t>(u);
+    return true;
+  }
+  return e.is_int() && e.is_numeral_i64(*v);
+}
+
+static inline bool is_symbol(expr const& e) {
+  return e.is_const() &&
+    e.decl().decl_kind() == Z3_OP_UNINTERPRETED;
+}
+
+static inline int128 bit_range(int64_t prec) {
+  return (int128(1) << (prec - 1)) - 1;
+}
+
+// Evaluate precision expression with the values of symbols.
+static bool eval(expr const& e,
+                 std::unordered_map<unsigned, int64_t> const& env,
+                 int64_t *v) {
+  int64_t a, b;
+  if (int_numeral(e, v)) return true;
+  if (is_symbol(e)) {
+    auto it = env.find(e.id());
+    if (it == env.end()) return false;
+    *v = it->second;
+    return true;
+  }
+  if (!e.is_app()) return false;
+  switch (e.decl().decl_kind()) {
+    case Z3_OP_BADD: case Z3_OP_ADD:
+      *v = 0;
+      for (unsigned i = 0; i < e.num_args(); ++i) {
+        if (!eval(e.arg(i), env, &a)) return false;
+        *v += a;
+      }
+      return true;
+    case Z3_OP_BSUB: case Z3_OP_SUB:
+      if (e.num_args() != 2 || !eval(e.arg(0), env, &a) ||
+          !eval(e.arg(1), env, &b)) return false;
+      *v = a - b;
+      return true;
+    case Z3_OP_ITE:
+      if (!eval(e.arg(0), env, &a)) return false;
+      return eval(e.arg(a ? 1 : 2), env, v);
+    case Z3_OP_TRUE: *v = 1; return true;
+    case Z3_OP_FALSE: *v = 0; return true;
+    case Z3_OP_NOT:
+      if (!eval(e.arg(0), env, &a)) return false;
+      *v = !a;
+      return true;
+    default: break;
+  }
+  if (e.num_args() != 2 || !eval(e.arg(0), env, &a) ||
+      !eval(e.arg(1), env, &b)) return false;
+  switch (e.decl().decl_kind()) {
+    case Z3_OP_SLEQ: case Z3_OP_LE: *v = a <= b; return true;
+    case Z3_OP_SLT: case Z3_OP_LT: *v = a < b; return true;
+    case Z3_OP_SGEQ: case Z3_OP_GE: *v = a >= b; return true;
+    case Z3_OP_SGT: case Z3_OP_GT: *v = a > b; return true;
+    case Z3_OP_EQ: *v = a == b; return true;
+    default: return false;
+  }
+}
+
+/*
+ * Numeral bounds of precision symbols and the definition of
+ *  output precision, collected from the background facts.
+ *  Unrecognized facts are dropped, which only enlarges the
+ *  cases to check.
+ **/
+struct PrecisionFacts {
+  std::unordered_map<unsigned, std::pair<int64_t, int64_t> > domain;
+  std::unordered_map<unsigned, expr> definition;
+
+  explicit PrecisionFacts(expr const& background) {
+    std::vector<expr> facts;
+    flatten_and(background, facts);
+    for (auto const& c : facts) {
+      if (!c.is_app() || c.num_args() != 2) continue;
+      expr a = c.arg(0), b = c.arg(1);
+      int64_t v;
+      Z3_decl_kind kind = c.decl().decl_kind();
+      if (kind == Z3_OP_EQ && is_symbol(a)) definition.emplace(a.id(), b);
+      if (is_symbol(a) && int_numeral(b, &v)) {
+        restrict(a, kind, v, false);
+      } else if (is_symbol(b) && int_numeral(a, &v)) {
+        restrict(b, kind, v, true);
+      }
+    }
+  }
+
+  std::pair<int64_t, int64_t> range(expr const& p) const {
+    int64_t v;
+    if (int_numeral(p, &v)) return std::make_pair(v, v);
+    std::pair<int64_t, int64_t> r(1, kMaxPrecision);
+    auto it = domain.find(p.id());
+    if (it != domain.end()) {
+      r.first = std::max(r.first, it->second.first);
+      r.second = std::min(r.second, it->second.second);
+    }
+    return r;
+  }
+
+ private:
+  // Fact `p op v`, or `v op p` if flipped.
+  void restrict(expr const& p, Z3_decl_kind kind, int64_t v, bool flip) {
+    auto it = domain.emplace(p.id(), std::make_pair(
+          std::numeric_limits<int64_t>::min(),
+          std::numeric_limits<int64_t>::max())).first;
+    int64_t &lo = it->second.first, &hi = it->second.second;
+    switch (kind) {
+      case Z3_OP_SLEQ: case Z3_OP_LE:
+        if (flip) lo = std::max(lo, v); else hi = std::min(hi, v);
+        break;
+      case Z3_OP_SLT: case Z3_OP_LT:
+        if (flip) lo = std::max(lo, v + 1); else hi = std::min(hi, v - 1);
+        break;
+      case Z3_OP_SGEQ: case Z3_OP_GE:
+        if (flip) hi = std::min(hi, v); else lo = std::max(lo, v);
+        break;
+      case Z3_OP_SGT: case Z3_OP_GT:
+        if (flip) hi = std::min(hi, v - 1); else lo = std::max(lo, v + 1);
+        break;
+      case Z3_OP_EQ:
+        lo = std::max(lo, v);
+        hi = std::min(hi, v);
+        break;
+      default: break;
+    }
+  }
+};
+
+/*
+ * Sum of products as the number of data-weight products, bias
+ *  terms and the absolute sum of constant terms.
+ **/
+struct MacShape {
+  int64_t products{0};
+  int64_t biases{0};
+  int128 constant{0};
+
+  inline bool operator<(MacShape const& t) const {
+    if (products != t.products) return products < t.products;
+    if (biases != t.biases) return biases < t.biases;
+    return constant < t.constant;
+  }
+};
+
+class MacMatcher {
+ public:
+  MacMatcher(TypePtr const& x, TypePtr const& w, TypePtr const& b) {
+    for (size_t i = 0; i < x->Size(); ++i) xs_.insert(x->at(i).data.id());
+    for (size_t i = 0; i < w->Size(); ++i) ws_.insert(w->at(i).data.id());
+    if (b) {
+      for (size_t i = 0; i < b->Size(); ++i) bs_.insert(b->at(i).data.id());
+    }
+  }
+
+  bool match(expr const& e, MacShape *shape) const {
+    int64_t v;
+    if (int_numeral(e, &v)) {
+      shape->constant += v < 0 ? -int128(v) : int128(v);
+      return true;
+    }
+    if (is_symbol(e)) {
+      if (!bs_.count(e.id())) return false;
+      shape->biases++;
+      return true;
+    }
+    if (!e.is_app()) return false;
+    Z3_decl_kind kind = e.decl().decl_kind();
+    if (kind == Z3_OP_BADD || kind == Z3_OP_ADD) {
+      for (unsigned i = 0; i < e.num_args(); ++i) {
+        if (!match(e.arg(i), shape)) return false;
+      }
+      return true;
+    }
+    if ((kind != Z3_OP_BMUL && kind != Z3_OP_MUL) ||
+        e.num_args() != 2) return false;
+    expr a = e.arg(0), b = e.arg(1);
+    // Zero padding of convolution.
+    if ((int_numeral(a, &v) && v == 0 && is_operand(b)) ||
+        (int_numeral(b, &v) && v == 0 && is_operand(a))) return true;
+    if ((xs_.count(a.id()) && ws_.count(b.id())) ||
+        (ws_.count(a.id()) && xs_.count(b.id()))) {
+      shape->products++;
+      return true;
+    }
+    return false;
+  }
+
+ private:
+  inline bool is_operand(expr const& e) const {
+    return xs_.count(e.id()) || ws_.count(e.id());
+  }
+
+  std::unordered_set<unsigned> xs_, ws_, bs_;
+};
+
+std::vector<bool> mac_discharge(
+    TypePtr const& x, TypePtr const& w, TypePtr const& b,
+    TypePtr const& y, z3_expr const& background) {
+  std::vector<bool> closed(y->Size(), false);
+  if (!mac_lemma()) return closed;
+
+  PrecisionFacts facts(background.cstr);
+  expr px = x->prec.data, pw = w->prec.data, py = y->prec.data;
+  // Precision is symbol, or numeral such as recorded in model.
+  auto is_prec = [](expr const& p) {
+    int64_t v;
+    return is_symbol(p) || int_numeral(p, &v);
+  };
+  if (!is_prec(px) || !is_prec(pw) || !is_symbol(py) ||
+      (b && !is_prec(b->prec.data))) return closed;
+  auto def = facts.definition.find(py.id());
+  if (def == facts.definition.end()) return closed;
+  expr oprec = def->second;
+
+  // Output shapes, the same shape is checked only once.
+  MacMatcher matcher(x, w, b);
+  std::vector<MacShape> shapes(y->Size());
+  std::vector<bool> matched(y->Size(), false);
+  std::map<MacShape, bool> verdicts;
+  for (size_t i = 0; i < y->Size(); ++i) {
+    expr value(C);
+    std::vector<expr> assigns;
+    flatten_and(y->assign_constraints(i).cstr, assigns);
+    bool found = false;
+    for (auto const& c : assigns) {
+      if (c.is_eq() && c.arg(0).id() == y->at(i).data.id()) {
+        value = c.arg(1);
+        found = true;
+      }
+    }
+    if (found && matcher.match(value, &shapes[i])) {
+      matched[i] = true;
+      verdicts.emplace(shapes[i], true);
+    }
+  }
+  if (verdicts.empty()) return closed;
+
+  // Chain the lemma in every case of precisions.
+  auto rx = facts.range(px), rw = facts.range(pw);
+  auto rb = b ? facts.range(b->prec.data) : std::pair<int64_t, int64_t>(1, 1);
+  auto ry = facts.range(py);
+  std::unordered_map<unsigned, int64_t> env;
+  for (int64_t vx = rx.first; vx <= rx.second; ++vx) {
+    for (int64_t vw = rw.first; vw <= rw.second; ++vw) {
+      for (int64_t vb = rb.first; vb <= rb.second; ++vb) {
+        env[px.id()] = vx;
+        env[pw.id()] = vw;
+        if (b) env[b->prec.data.id()] = vb;
+        int64_t vy;
+        if (!eval(oprec, env, &vy)) return closed;
+        // Out of the precision constraints of output, vacuous.
+        if (vy < ry.first || vy > ry.second) continue;
+        int128 limit = std::min(bit_range(vy), kInt64Max);
+        int128 product = bit_range(vx) * bit_range(vw);
+        int128 bias = b ? bit_range(vb) : 0;
+        for (auto &it : verdicts) {
+          MacShape const& s = it.first;
+          it.second = it.second &&
+            s.products * product + s.biases * bias + s.constant <= limit;
+        }
+      }
+    }
+  }
+  for (size_t i = 0; i < y->Size(); ++i) {
+    closed[i] = matched[i] && verdicts[shapes[i]];
+  }
+  return closed;
+}
+
+}
+}
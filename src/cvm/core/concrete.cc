@@ -0,0 +1,170 @@
+#include <sstream>
+
+#include "cvm/node.h"
+
+namespace z3 {
+namespace cvm {
+
+using namespace z3::type;
+
+/*
+ * Value of expression in model, the symbols not in model are
+ *  completed. Bit-vector is read as signed integer. Returns
+ *  false if the value is not a numeral of int64.
+ **/
+static bool eval_int64(model const& m, expr const& e, int64_t *v) {
+  expr r = m.eval(e, true);
+  if (r.is_bv()) {
+    uint64_t u;
+    if (!r.is_numeral_u64(u)) return false;
+    unsigned bits = r.get_sort().bv_size();
+    if (bits < 64 && ((u >> (bits - 1)) & 1)) u |= ~uint64_t(0) << bits;
+    *v = static_cast<int64_t>(u);
+    return true;
+  }
+  return r.is_numeral_i64(*v);
+}
+
+/*
+ * First element of outputs evaluated in m which differs from the
+ *  concrete one, empty if all equal.
+ **/
+static std::string first_mismatch(
+    model const& m, std::string const& name,
+    std::vector<TypePtr> const& outputs,
+    std::vector<ConcreteTensor> const& out_data) {
+  std::ostringstream os;
+  for (size_t k = 0; k < out_data.size(); ++k) {
+    TypePtr const& tp = outputs[k];
+    auto const& d = out_data[k].data;
+    for (size_t i = 0; i < d.size(); ++i) {
+      int64_t v;
+      if (!eval_int64(m, tp->assigned(i).data, &v)) {
+        os << name << "[" << i << "] is not int64 in forward";
+        return os.str();
+      }
+      if (v != d[i]) {
+        os << name << "[" << i << "] = " << v
+          << " in forward vs. " << d[i] << " concrete";
+        return os.str();
+      }
+    }
+  }
+  return "";
+}
+
+bool Node::concrete_inputs(model const& m,
+                           std::vector<ConcreteTensor> *inputs,
+                           std::string *detail) {
+  if (is_variable() || op()->concrete == nullptr) {
+    *detail = is_variable() ? "variable " + attrs.name :
+      "operator " + op()->name + " has no concrete executor";
+    return false;
+  }
+  inputs->clear();
+  for (auto &e : this->inputs) {
+    TypePtr const& tp = e.node->data_[e.index];
+    ConcreteTensor t(tp->shape);
+    for (size_t i = 0; i < t.Size(); ++i) {
+      if (!eval_int64(m, tp->at(i).data, &t.data[i])) {
+        *detail = "input " + e.node->attrs.name + "[" +
+          std::to_string(i) + "] is not int64";
+        return false;
+      }
+    }
+    inputs->push_back(std::move(t));
+  }
+  return true;
+}
+
+std::vector<ConcreteTensor> Node::execute(
+    std::vector<ConcreteTensor> const& inputs,
+    ConcreteFaults &faults) {
+  std::vector<ConcreteTensor> outputs;
+  for (auto &tp : data_) outputs.emplace_back(tp->shape);
+  op()->concrete(attrs, inputs, outputs, faults);
+  return outputs;
+}
+
+ReplayVerdict Node::replay(model const& m) {
+  ReplayVerdict verdict;
+  std::vector<ConcreteTensor> in_data;
+  if (!concrete_inputs(m, &in_data, &verdict.detail)) return verdict;
+
+  // The counterexample must respect the domains of inputs.
+  std::ostringstream os;
+  for (size_t k = 0; k < in_data.size(); ++k) {
+    NodeEntry &e = inputs[k];
+    TypePtr const& tp = e.node->data_[e.index];
+    int64_t prec = 0;
+    if (!eval_int64(m, tp->prec.data, &prec) || prec < 1 || prec > 32) {
+      os << "precision " << prec << " of input " << e.node->attrs.name
+        << " is out of [1, 32]";
+      verdict.detail = os.str();
+      return verdict;
+    }
+    int64_t r = concrete::prec_range(prec);
+    auto const& d = in_data[k].data;
+    for (size_t i = 0; i < d.size(); ++i) {
+      if (d[i] < -r || d[i] > r) {
+        os << "input " << e.node->attrs.name << "[" << i << "] = "
+          << d[i] << " exceeds precision " << prec;
+        verdict.detail = os.str();
+        return verdict;
+      }
+    }
+  }
+
+  ConcreteFaults faults;
+  std::vector<ConcreteTensor> out_data = execute(in_data, faults);
+  if (!faults.empty()) {
+    os << faults.count() << " faults of " << op()->name
+      << ", first " << faults.first();
+    verdict.confirmed = true;
+    verdict.detail = os.str();
+    return verdict;
+  }
+  for (size_t k = 0; k < out_data.size(); ++k) {
+    TypePtr const& tp = data_[k];
+    int64_t prec = 0;
+    if (!eval_int64(m, tp->assigned(tp->Size()).data, &prec) ||
+        prec < 1 || prec > 32) {
+      os << "output precision " << prec << " is out of [1, 32]";
+      verdict.detail = os.str();
+      return verdict;
+    }
+    int64_t r = concrete::prec_range(prec);
+    auto const& d = out_data[k].data;
+    for (size_t i = 0; i < d.size(); ++i) {
+      if (d[i] < -r || d[i] > r) {
+        os << attrs.name << "[" << i << "] = " << d[i]
+          << " exceeds precision " << prec;
+        verdict.confirmed = true;
+        verdict.detail = os.str();
+        return verdict;
+      }
+    }
+  }
+  // Spurious counterexample, such as the forward disagrees.
+  std::string mismatch = first_mismatch(m, attrs.name, data_, out_data);
+  verdict.detail = "outputs fit in precision";
+  if (!mismatch.empty()) verdict.detail += ", " + mismatch;
+  return verdict;
+}
+
+std::string Node::differential(model const& m) {
+  std::string detail;
+  std::vector<ConcreteTensor> in_data;
+  if (!concrete_inputs(m, &in_data, &detail)) return detail;
+
+  ConcreteFaults faults;
+  std::vector<ConcreteTensor> out_data = execute(in_data, faults);
+  if (!faults.empty()) {
+    return std::to_string(faults.count()) + " faults, first " +
+      faults.first();
+  }
+  return first_mismatch(m, attrs.name, data_, out_data);
+}
+
+}
+}
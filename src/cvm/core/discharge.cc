@@ -0,0 +1,114 @@
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "z3++.h"
+
+#include "cvm/discharge.h"
+
+namespace z3 {
+namespace cvm {
+
+void flatten_and(expr const& e, std::vector<expr> &conjuncts) {
+  std::vector<expr> stack{e};
+  while (!stack.empty()) {
+    expr t = stack.back();
+    stack.pop_back();
+    if (t.is_app() && t.decl().decl_kind() == Z3_OP_AND) {
+      for (unsigned i = t.num_args(); i > 0; --i) {
+        stack.push_back(t.arg(i - 1));
+      }
+    } else if (!t.is_true()) {
+      conjuncts.push_back(t);
+    }
+  }
+}
+
+static inline bool is_symbol(expr const& e) {
+  return e.is_const() &&
+    e.decl().decl_kind() == Z3_OP_UNINTERPRETED;
+}
+
+class SymbolUnion {
+ public:
+  void merge(expr const& a, expr const& b) {
+    size_t ra = find(index(a)), rb = find(index(b));
+    if (ra != rb) parent_[rb] = ra;
+  }
+
+  bool empty() const { return symbols_.empty(); }
+
+  void substitution(expr_vector &src, expr_vector &dst) {
+    for (size_t i = 0; i < symbols_.size(); ++i) {
+      size_t r = find(i);
+      if (r == i) continue;
+      src.push_back(symbols_[i]);
+      dst.push_back(symbols_[r]);
+    }
+  }
+
+ private:
+  size_t index(expr const& e) {
+    auto it = ids_.find(e.id());
+    if (it != ids_.end()) return it->second;
+    ids_[e.id()] = symbols_.size();
+    symbols_.push_back(e);
+    parent_.push_back(parent_.size());
+    return symbols_.size() - 1;
+  }
+
+  size_t find(size_t i) {
+    while (parent_[i] != i) {
+      parent_[i] = parent_[parent_[i]];
+      i = parent_[i];
+    }
+    return i;
+  }
+
+  std::unordered_map<unsigned, size_t> ids_;
+  std::vector<expr> symbols_;
+  std::vector<size_t> parent_;
+};
+
+bool syntactic_discharge(expr const& cstr) {
+  if (cstr.is_true()) return true;
+  if (!cstr.is_app() ||
+      cstr.decl().decl_kind() != Z3_OP_IMPLIES) return false;
+
+  std::vector<expr> ins, outs;
+  flatten_and(cstr.arg(0), ins);
+  flatten_and(cstr.arg(1), outs);
+
+  SymbolUnion symbols;
+  for (auto const& c : ins) {
+    if (c.is_eq() && is_symbol(c.arg(0)) && is_symbol(c.arg(1))) {
+      symbols.merge(c.arg(0), c.arg(1));
+    }
+  }
+
+  expr_vector src(cstr.ctx()), dst(cstr.ctx());
+  symbols.substitution(src, dst);
+  auto rewrite = [&src, &dst](expr const& e) {
+    // Substitute is a method of non-const expr.
+    expr t = e;
+    return src.empty() ? t : t.substitute(src, dst);
+  };
+
+  // Keep the rewritten asts alive, so that ids are not reused.
+  std::unordered_set<unsigned> facts;
+  std::vector<expr> keep;
+  for (auto const& c : ins) {
+    keep.push_back(rewrite(c));
+    facts.insert(keep.back().id());
+  }
+  for (auto const& c : outs) {
+    expr t = rewrite(c);
+    if (t.is_true() || facts.count(t.id())) continue;
+    if (t.is_eq() && t.arg(0).id() == t.arg(1).id()) continue;
+    return false;
+  }
+  return true;
+}
+
+}
+}
@@ -0,0 +1,490 @@
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cvm/graph.h"
+#include "cvm/params.h"
+
+namespace z3 {
+namespace cvm {
+
+using namespace type;
+
+/*
+ * Minimal json value, which is enough for the symbol json. The
+ *  text of number is kept, so that integers are exact.
+ **/
+struct JsonValue {
+  enum Kind { kNull, kBool, kNumber, kString, kArray, kObject };
+  Kind kind{kNull};
+  bool boolean{false};
+  // Content of string, or text of number.
+  std::string str;
+  std::vector<JsonValue> array;
+  std::vector<std::pair<std::string, JsonValue> > object;
+
+  const JsonValue* find(const std::string &key) const {
+    for (auto const& kv : object) {
+      if (kv.first == key) return &kv.second;
+    }
+    return nullptr;
+  }
+
+  const JsonValue& at(const std::string &key) const {
+    const JsonValue *v = find(key);
+    VERIFY_NE(v, nullptr) << "json key " << key << " is missing";
+    return *v;
+  }
+
+  int64_t as_int() const {
+    VERIFY_EQ(kind, kNumber) << "json value is not number";
+    return std::strtoll(str.c_str(), nullptr, 10);
+  }
+
+  const std::string& as_string() const {
+    VERIFY_EQ(kind, kString) << "json value is not string";
+    return str;
+  }
+
+  const std::vector<JsonValue>& as_array() const {
+    VERIFY_EQ(kind, kArray) << "json value is not array";
+    return array;
+  }
+};
+
+class JsonParser {
+ public:
+  explicit JsonParser(const std::string &text) : text_(text) {}
+
+  JsonValue parse() {
+    JsonValue v = value();
+    skip();
+    VERIFY_EQ(pos_, text_.size())
+      << "json has trailing characters at " << pos_;
+    return v;
+  }
+
+ private:
+  void skip() {
+    while (pos_ < text_.size() &&
+           (text_[pos_] == ' ' || text_[pos_] == '\n' ||
+            text_[pos_] == '\t' || text_[pos_] == '\r')) {
+      ++pos_;
+    }
+  }
+
+  char peek() {
+    skip();
+    VERIFY(pos_ < text_.size()) << "json ends unexpectedly";
+    return text_[pos_];
+  }
+
+  void expect(char c) {
+    VERIFY_EQ(peek(), c)
+      << "json expects '" << c << "' at " << pos_;
+    ++pos_;
+  }
+
+  bool literal(const char *word) {
+    size_t n = std::string(word).size();
+    if (text_.compare(pos_, n, word) != 0) return false;
+    pos_ += n;
+    return true;
+  }
+
+  JsonValue value() {
+    JsonValue v;
+    char c = peek();
+    if (c == '{') {
+      v.kind = JsonValue::kObject;
+      ++pos_;
+      if (peek() == '}') { ++pos_; return v; }
+      while (true) {
+        std::string key = string();
+        expect(':');
+        v.object.emplace_back(key, value());
+        if (peek() == '}') { ++pos_; return v; }
+        expect(',');
+      }
+    }
+    if (c == '[') {
+      v.kind = JsonValue::kArray;
+      ++pos_;
+      if (peek() == ']') { ++pos_; return v; }
+      while (true) {
+        v.array.push_back(value());
+        if (peek() == ']') { ++pos_; return v; }
+        expect(',');
+      }
+    }
+    if (c == '"') {
+      v.kind = JsonValue::kString;
+      v.str = string();
+      return v;
+    }
+    if (literal("true")) {
+      v.kind = JsonValue::kBool;
+      v.boolean = true;
+      return v;
+    }
+    if (literal("false")) {
+      v.kind = JsonValue::kBool;
+      return v;
+    }
+    if (literal("null")) return v;
+
+    size_t start = pos_;
+    while (pos_ < text_.size() &&
+           (std::isdigit(text_[pos_]) || text_[pos_] == '-' ||
+            text_[pos_] == '+' || text_[pos_] == '.' ||
+            text_[pos_] == 'e' || text_[pos_] == 'E')) {
+      ++pos_;
+    }
+    VERIFY(pos_ > start) << "json value is invalid at " << start;
+    v.kind = JsonValue::kNumber;
+    v.str = text_.substr(start, pos_ - start);
+    return v;
+  }
+
+  std::string string() {
+    expect('"');
+    std::string s;
+    while (true) {
+      VERIFY(pos_ < text_.size()) << "json string is not closed";
+      char c = text_[pos_++];
+      if (c == '"') return s;
+      if (c != '\\') {
+        s.push_back(c);
+        continue;
+      }
+      VERIFY(pos_ < text_.size()) << "json string is not closed";
+      c = text_[pos_++];
+      switch (c) {
+        case 'n': s.push_back('\n'); break;
+        case 't': s.push_back('\t'); break;
+        case 'r': s.push_back('\r'); break;
+        case 'b': s.push_back('\b'); break;
+        case 'f': s.push_back('\f'); break;
+        case 'u': {
+          // Names and attributes are ascii, others are kept.
+          VERIFY(pos_ + 4 <= text_.size()) << "json escape is invalid";
+          unsigned code = std::stoul(text_.substr(pos_, 4), nullptr, 16);
+          pos_ += 4;
+          if (code < 0x80) s.push_back(static_cast<char>(code));
+          else s += "\\u" + text_.substr(pos_ - 4, 4);
+          break;
+        }
+        default: s.push_back(c); break;
+      }
+    }
+  }
+
+  const std::string &text_;
+  size_t pos_{0};
+};
+
+// Attribute value as the string of op attrs, such as "(3, 3)".
+static std::string attr_string(JsonValue const& v) {
+  switch (v.kind) {
+    case JsonValue::kString: return v.str;
+    case JsonValue::kNumber: return v.str;
+    case JsonValue::kBool: return v.boolean ? "true" : "false";
+    case JsonValue::kArray: {
+      std::string s = "(";
+      for (size_t i = 0; i < v.array.size(); ++i) {
+        if (i > 0) s += ", ";
+        s += attr_string(v.array[i]);
+      }
+      return s + ")";
+    }
+    default: break;
+  }
+  THROW() << "attribute value must be string, number, bool or list";
+  return "";
+}
+
+// List of graph attrs, with or without the type tag.
+static const JsonValue* graph_attr(JsonValue const& root,
+                                   const std::string &key) {
+  const JsonValue *attrs = root.find("attrs");
+  if (attrs == nullptr) return nullptr;
+  const JsonValue *v = attrs->find(key);
+  if (v == nullptr) return nullptr;
+  auto const& arr = v->as_array();
+  if (arr.size() == 2 && arr[0].kind == JsonValue::kString) {
+    return &arr[1];
+  }
+  return v;
+}
+
+static std::string read_file(const std::string &path) {
+  std::ifstream ifs(path);
+  VERIFY(ifs.is_open()) << "graph json " << path << " can't be opened";
+  std::stringstream ss;
+  ss << ifs.rdbuf();
+  return ss.str();
+}
+
+Graph::~Graph() {
+  // Released in reverse topological order, so that releasing a
+  //  node never cascades through the chain of its inputs.
+  heads_.clear();
+  while (!nodes_.empty()) nodes_.pop_back();
+}
+
+/*
+ * Cut of the node entry, a variable of the same shape and data
+ *  symbols, whose precision is the proven one of entry. Only the
+ *  output contract of entry is assumed by the cut.
+ **/
+static NodeEntry cut_entry(NodeEntry e) {
+  TypePtr const& tp = e.operator->();
+  return Node::CreateVariable<TypeRef>(
+      e.node->attrs.name, tp->shape, tp->proven_prec());
+}
+
+/*
+ * Builder of the nodes of symbol json, one node at a time in
+ *  topological order, see Graph.
+ **/
+class GraphBuilder {
+ public:
+  GraphBuilder(JsonValue const& root, bool contracts,
+               const Params *params)
+    : root_(root),
+      nodes_json_(root.at("nodes").as_array()),
+      shapes_(graph_attr(root, "shape")),
+      precs_(graph_attr(root, "precision")),
+      row_ptr_(root.find("node_row_ptr")),
+      contracts_(contracts),
+      params_(params),
+      nodes_(nodes_json_.size()) {}
+
+  inline size_t size() const { return nodes_json_.size(); }
+  inline JsonValue const& json(size_t nid) const {
+    return nodes_json_[nid];
+  }
+  inline NodePtr const& node(size_t nid) const { return nodes_[nid]; }
+
+  NodePtr const& build(size_t nid) {
+    auto const& n = nodes_json_[nid];
+    std::string const& op_name = n.at("op").as_string();
+    std::string const& name = n.at("name").as_string();
+    size_t row = row_ptr_ ? row_ptr_->as_array().at(nid).as_int() : entry_;
+
+    NodeEntry ne;
+    if (op_name == "null") {
+      VERIFY_NE(shapes_, nullptr)
+        << "graph shape is required by variable " << name;
+      VERIFY(row < shapes_->as_array().size())
+        << "graph shape of variable " << name << " is missing";
+      Shape shape;
+      for (auto const& d : shapes_->as_array()[row].as_array()) {
+        shape.push_back(d.as_int());
+      }
+      int64_t prec = 0;
+      if (precs_ && row < precs_->as_array().size()) {
+        prec = precs_->as_array()[row].as_int();
+      }
+      const ParamTensor *param = params_ ? params_->find(name) : nullptr;
+      if (param != nullptr) {
+        ne = constant(name, shape, prec, *param);
+      } else {
+        ne = prec > 0 ?
+          Node::CreateVariable<TypeRef>(name, shape, z3_expr(int(prec))) :
+          Node::CreateVariable<TypeRef>(name, shape);
+      }
+    } else {
+      std::vector<NodeEntry> inputs;
+      for (auto const& in : n.at("inputs").as_array()) {
+        auto const& e = in.as_array();
+        size_t src = e.at(0).as_int();
+        VERIFY(src < nid)
+          << "input of " << name << " is not in topological order";
+        VERIFY_NE(nodes_[src], nullptr)
+          << "input " << src << " of " << name << " is released";
+        NodeEntry input(nodes_[src], e.at(1).as_int(),
+                        e.size() > 2 ? e[2].as_int() : 0);
+        if (contracts_ && !input.node->is_variable()) {
+          size_t key = rows_[src] + input.index;
+          auto it = cuts_.find(key);
+          if (it == cuts_.end()) {
+            it = cuts_.emplace(key, cut_entry(input)).first;
+          }
+          input = it->second;
+        }
+        inputs.push_back(std::move(input));
+      }
+      std::unordered_map<std::string, std::string> attrs;
+      const JsonValue *dict = n.find("attrs");
+      if (dict == nullptr) dict = n.find("attr");
+      if (dict == nullptr) dict = n.find("param");
+      if (dict != nullptr) {
+        for (auto const& kv : dict->object) {
+          if (kv.second.kind == JsonValue::kNull) continue;
+          attrs[kv.first] = attr_string(kv.second);
+        }
+      }
+      VERIFY_NE(utils::Registry<Op>::Find(op_name), nullptr)
+        << "operator " << op_name << " of node " << name
+        << " is not supported";
+      ne = Node::CreateOperator(op_name.c_str(), name,
+                                std::move(inputs), std::move(attrs));
+      for (uint32_t i = 0; shapes_ && i < ne.node->num_outputs(); ++i) {
+        if (row + i >= shapes_->as_array().size()) break;
+        Shape expected;
+        for (auto const& d : shapes_->as_array()[row + i].as_array()) {
+          expected.push_back(d.as_int());
+        }
+        Shape const& inferred = NodeEntry(ne.node, i, 0)->shape;
+        VERIFY(inferred == expected)
+          << "operator " << op_name << "(" << name << ") output " << i
+          << " infers shape " << inferred.to_string()
+          << " vs. recorded " << expected.to_string();
+      }
+    }
+    entry_ += ne.node->num_outputs();
+    rows_.push_back(row);
+    nodes_[nid] = ne.node;
+    return nodes_[nid];
+  }
+
+  // Release the node and the cuts of its outputs.
+  void release(size_t nid) {
+    NodePtr &n = nodes_[nid];
+    if (n == nullptr) return;
+    for (uint32_t i = 0; contracts_ && i < n->num_outputs(); ++i) {
+      auto it = cuts_.find(rows_[nid] + i);
+      if (it == cuts_.end()) continue;
+      it->second.node->release();
+      cuts_.erase(it);
+    }
+    n->release();
+    n.reset();
+  }
+
+  std::vector<NodeEntry> heads() const {
+    std::vector<NodeEntry> heads;
+    for (auto const& h : root_.at("heads").as_array()) {
+      auto const& e = h.as_array();
+      size_t nid = e.at(0).as_int();
+      VERIFY(nid < nodes_.size()) << "graph head " << nid << " is invalid";
+      heads.emplace_back(nodes_[nid], e.at(1).as_int(),
+                         e.size() > 2 ? e[2].as_int() : 0);
+    }
+    return heads;
+  }
+
+  inline std::vector<NodePtr> take_nodes() { return std::move(nodes_); }
+
+ private:
+  /*
+   * Variable bound to the concrete values of param, whose
+   *  precision is the recorded one, or the least one of values
+   *  if it's absent.
+   **/
+  static NodeEntry constant(std::string const& name, Shape const& shape,
+                            int64_t prec, ParamTensor const& param) {
+    VERIFY(param.shape == shape)
+      << "param " << name << " of shape " << param.shape.to_string()
+      << " vs. recorded " << shape.to_string();
+    int64_t max_abs = 0;
+    std::vector<z3_expr> values;
+    values.reserve(shape.Size());
+    for (size_t i = 0; i < shape.Size(); ++i) {
+      int64_t v = param.at(i);
+      VERIFY(v > INT32_MIN && v <= INT32_MAX)
+        << "param " << name << "[" << i << "] = " << v
+        << " is out of int32";
+      max_abs = std::max(max_abs, v < 0 ? -v : v);
+      values.emplace_back(int(v));
+    }
+    int64_t bits = 1;
+    while (bits < 32 && (int64_t{1} << (bits - 1)) - 1 < max_abs) bits++;
+    if (prec <= 0) prec = bits;
+    VERIFY(bits <= prec)
+      << "param " << name << " has value " << max_abs
+      << " out of the precision " << prec;
+    return Node::CreateVariable<Constant>(
+        name, shape, z3_expr(int(prec)), values);
+  }
+
+  JsonValue const& root_;
+  std::vector<JsonValue> const& nodes_json_;
+  const JsonValue *shapes_;
+  const JsonValue *precs_;
+  const JsonValue *row_ptr_;
+  bool contracts_;
+  const Params *params_;
+  std::vector<NodePtr> nodes_;
+  // Entry of node output without node_row_ptr.
+  size_t entry_{0};
+  // Node entry of the first output, by node id.
+  std::vector<size_t> rows_;
+  // Cuts of operator outputs by node entry, shared by the users.
+  std::unordered_map<size_t, NodeEntry> cuts_;
+};
+
+std::unique_ptr<Graph> Graph::FromJson(const std::string &json,
+                                       bool contracts,
+                                       const Params *params) {
+  JsonValue root = JsonParser(json).parse();
+  std::unique_ptr<Graph> g(new Graph);
+  GraphBuilder builder(root, contracts, params);
+  for (size_t nid = 0; nid < builder.size(); ++nid) builder.build(nid);
+  g->heads_ = builder.heads();
+  g->nodes_ = builder.take_nodes();
+  return g;
+}
+
+std::unique_ptr<Graph> Graph::Load(const std::string &path,
+                                   bool contracts,
+                                   const Params *params) {
+  return FromJson(read_file(path), contracts, params);
+}
+
+void Graph::Walk(const std::string &path, bool contracts,
+                 const Params *params,
+                 std::function<void(NodePtr const&)> const& visit) {
+  JsonValue root = JsonParser(read_file(path)).parse();
+  GraphBuilder builder(root, contracts, params);
+  // Number of consumers not visited yet, by node id.
+  std::vector<size_t> pending(builder.size(), 0);
+  std::vector<std::vector<size_t> > sources(builder.size());
+  for (size_t nid = 0; nid < builder.size(); ++nid) {
+    const JsonValue *inputs = builder.json(nid).find("inputs");
+    if (inputs == nullptr) continue;
+    for (auto const& in : inputs->as_array()) {
+      size_t src = in.as_array().at(0).as_int();
+      auto &srcs = sources[nid];
+      if (std::find(srcs.begin(), srcs.end(), src) != srcs.end()) continue;
+      srcs.push_back(src);
+      if (src < builder.size()) pending[src]++;
+    }
+  }
+  for (size_t nid = 0; nid < builder.size(); ++nid) {
+    visit(builder.build(nid));
+    bool released = false;
+    for (size_t src : sources[nid]) {
+      if (--pending[src] == 0) {
+        builder.release(src);
+        released = true;
+      }
+    }
+    if (pending[nid] == 0) {
+      builder.release(nid);
+      released = true;
+    }
+    // The memo keeps the constraints of released nodes alive.
+    if (released) ClearSimplifyMemo();
+  }
+}
+
+}
+}
@@ -0,0 +1,789 @@
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "z3++.h"
+
+#include "cvm/discharge.h"
+
+namespace z3 {
+namespace cvm {
+
+/*
+ * Signed closed interval of bit-vector with the given width,
+ *  values are kept in 128 bits so that overflow of 64 bits
+ *  operation is detectable, and the result wraps to the whole
+ *  range once overflow may happen.
+ **/
+using int128 = __int128;
+
+struct Interval {
+  int128 lo, hi;
+  unsigned width;
+
+  static inline int128 min_value(unsigned w) {
+    return -(int128(1) << (w - 1));
+  }
+  static inline int128 max_value(unsigned w) {
+    return (int128(1) << (w - 1)) - 1;
+  }
+  static inline Interval top(unsigned w) {
+    return {min_value(w), max_value(w), w};
+  }
+  static inline Interval point(int128 v, unsigned w) {
+    return {v, v, w};
+  }
+  static inline Interval none(unsigned w) {
+    return {1, 0, w};
+  }
+
+  inline bool empty() const { return lo > hi; }
+  inline bool is_point() const { return lo == hi; }
+  inline bool contains(int128 v) const { return lo <= v && v <= hi; }
+
+  // Wrap the exact result into the range of width.
+  static inline Interval fit(int128 lo, int128 hi, unsigned w) {
+    if (lo >= min_value(w) && hi <= max_value(w)) return {lo, hi, w};
+    if (lo != hi) return top(w);
+    int128 m = int128(1) << w;
+    int128 v = ((lo % m) + m) % m;
+    if (v > max_value(w)) v -= m;
+    return point(v, w);
+  }
+  static inline Interval hull(std::vector<int128> const& vs, unsigned w) {
+    return fit(*std::min_element(vs.begin(), vs.end()),
+               *std::max_element(vs.begin(), vs.end()), w);
+  }
+};
+
+enum class Tri { kFalse, kTrue, kUnknown };
+
+static inline Tri tri(bool b) { return b ? Tri::kTrue : Tri::kFalse; }
+static inline Tri tri_not(Tri t) {
+  return t == Tri::kUnknown ? t : tri(t == Tri::kFalse);
+}
+
+/*
+ * Abstract interpretation of obligation over intervals.
+ *
+ *  The facts, conjuncts of obligation antecedent, are indexed by
+ *  symbol: bounds such as `a_0 <= bit_range(a_prec)` and the
+ *  definitions such as `o_0 == a_0 + b_0`. The interval of a
+ *  symbol is the intersection of its bounds and definitions,
+ *  facts of other form are only used to detect infeasible case.
+ *
+ *  Precision symbols have a small numeral domain, such as
+ *  [1, 32], and range terms like `(1 << (prec - 1)) - 1` are
+ *  hardly bounded with symbolic precision, so the analyzer
+ *  splits cases on every value of them, where the range terms
+ *  become exact.
+ **/
+class IntervalAnalyzer {
+ public:
+  explicit IntervalAnalyzer(std::vector<expr> const& facts);
+
+  bool prove(std::vector<expr> const& goals);
+  /*
+   * Smallest signed width which all the terms fit in every
+   *  case, or limit if unknown.
+   **/
+  unsigned width(std::vector<expr> const& terms, unsigned limit);
+
+ private:
+  struct Bound {
+    expr e;
+    int adjust;
+  };
+  struct SymbolInfo {
+    std::vector<Bound> lowers;
+    std::vector<Bound> uppers;
+    std::vector<expr> defs;
+    bool has_lo{false}, has_hi{false};
+    int128 lo{0}, hi{0};
+  };
+
+  // Enumerate assignments of split symbols, until visit fails.
+  template<typename F>
+  bool for_each_case(F const& visit);
+  bool prove_case(std::vector<expr> const& goals);
+  // Whether the antecedent is false in current case.
+  bool infeasible_case();
+
+  Interval term(expr const& e);
+  Interval symbol(expr const& e);
+  Tri formula(expr const& e);
+
+  using Env = std::unordered_map<unsigned, Interval>;
+  // Refine the operands of comparison cond assumed as value.
+  bool refine(expr const& cond, bool value, Env &env);
+  /*
+   * Evaluate under the assumed conditions, such as ite branch
+   *  and antecedent of implication. Returns false if the
+   *  assumption is infeasible, and eval is not invoked.
+   **/
+  template<typename F>
+  bool assume(std::vector<expr> const& conds, bool value, F const& eval);
+
+  void add_lower(expr const& x, expr const& b, int adjust);
+  void add_upper(expr const& x, expr const& b, int adjust);
+
+  std::unordered_map<unsigned, SymbolInfo> symbols_;
+  std::vector<expr> others_;
+
+  std::vector<expr> split_;
+  std::unordered_map<unsigned, int128> assignment_;
+
+  // Per case state.
+  std::unordered_map<unsigned, Interval> terms_;
+  std::unordered_map<unsigned, Tri> formulas_;
+  std::unordered_set<unsigned> visiting_;
+  bool infeasible_{false};
+  size_t depth_{0};
+};
+
+static const int128 kMaxDomain = 64;
+static const size_t kMaxCases = 4096;
+// Branch evaluation re-evaluates the branch without the memo of
+//  enclosing scope, nested branches are joined beyond the depth.
+static const size_t kMaxBranchDepth = 4;
+
+static inline bool is_symbol(expr const& e) {
+  return e.is_const() &&
+    e.decl().decl_kind() == Z3_OP_UNINTERPRETED;
+}
+
+static bool bv_numeral(expr const& e, int128 *v) {
+  uint64_t u;
+  if (!e.is_bv() || e.get_sort().bv_size() > 64 ||
+      !e.is_numeral_u64(u)) return false;
+  unsigned w = e.get_sort().bv_size();
+  int128 x = u;
+  if (x > Interval::max_value(w)) x -= int128(1) << w;
+  *v = x;
+  return true;
+}
+
+void IntervalAnalyzer::add_lower(
+    expr const& x, expr const& b, int adjust) {
+  SymbolInfo &info = symbols_[x.id()];
+  info.lowers.push_back({b, adjust});
+  int128 v;
+  if (bv_numeral(b, &v)) {
+    v += adjust;
+    info.lo = info.has_lo ? std::max(info.lo, v) : v;
+    info.has_lo = true;
+  }
+}
+
+void IntervalAnalyzer::add_upper(
+    expr const& x, expr const& b, int adjust) {
+  SymbolInfo &info = symbols_[x.id()];
+  info.uppers.push_back({b, adjust});
+  int128 v;
+  if (bv_numeral(b, &v)) {
+    v -= adjust;
+    info.hi = info.has_hi ? std::min(info.hi, v) : v;
+    info.has_hi = true;
+  }
+}
+
+IntervalAnalyzer::IntervalAnalyzer(std::vector<expr> const& facts) {
+  std::unordered_map<unsigned, expr> names;
+  for (auto const& c : facts) {
+    if (!c.is_app() || c.num_args() != 2 || !c.arg(0).is_bv()) {
+      others_.push_back(c);
+      continue;
+    }
+    expr a = c.arg(0), b = c.arg(1);
+    bool recognized = is_symbol(a) || is_symbol(b);
+    switch (c.decl().decl_kind()) {
+      case Z3_OP_SLEQ:
+        if (is_symbol(b)) add_lower(b, a, 0);
+        if (is_symbol(a)) add_upper(a, b, 0);
+        break;
+      case Z3_OP_SLT:
+        if (is_symbol(b)) add_lower(b, a, 1);
+        if (is_symbol(a)) add_upper(a, b, 1);
+        break;
+      case Z3_OP_SGEQ:
+        if (is_symbol(a)) add_lower(a, b, 0);
+        if (is_symbol(b)) add_upper(b, a, 0);
+        break;
+      case Z3_OP_SGT:
+        if (is_symbol(a)) add_lower(a, b, 1);
+        if (is_symbol(b)) add_upper(b, a, 1);
+        break;
+      case Z3_OP_EQ:
+        // Assignment of TypeRef::set_data is `data == value`,
+        //  so the left symbol is the defined one.
+        if (is_symbol(a)) symbols_[a.id()].defs.push_back(b);
+        else if (is_symbol(b)) symbols_[b.id()].defs.push_back(a);
+        break;
+      default:
+        recognized = false;
+    }
+    if (!recognized) others_.push_back(c);
+    if (is_symbol(a)) names.emplace(a.id(), a);
+    if (is_symbol(b)) names.emplace(b.id(), b);
+  }
+
+  // Split on symbols of small numeral domain, the definitions
+  //  of output symbols are evaluated instead.
+  for (auto const& it : symbols_) {
+    SymbolInfo const& info = it.second;
+    if (!info.defs.empty() || !info.has_lo || !info.has_hi) continue;
+    if (info.hi - info.lo + 1 > kMaxDomain) continue;
+    split_.push_back(names.at(it.first));
+  }
+  // Deterministic order of enumeration.
+  std::sort(split_.begin(), split_.end(),
+      [](expr const& a, expr const& b) { return a.id() < b.id(); });
+}
+
+template<typename F>
+bool IntervalAnalyzer::for_each_case(F const& visit) {
+  size_t cases = 1;
+  for (auto const& s : split_) {
+    SymbolInfo const& info = symbols_[s.id()];
+    // Empty domain, the antecedent is unsatisfiable.
+    if (info.lo > info.hi) return true;
+    cases *= static_cast<size_t>(info.hi - info.lo + 1);
+    if (cases > kMaxCases) return false;
+  }
+
+  for (auto const& s : split_) {
+    assignment_[s.id()] = symbols_[s.id()].lo;
+  }
+  while (true) {
+    terms_.clear();
+    formulas_.clear();
+    visiting_.clear();
+    infeasible_ = false;
+    if (!visit()) return false;
+    // Next assignment in odometer order.
+    size_t k = 0;
+    for (; k < split_.size(); ++k) {
+      SymbolInfo const& info = symbols_[split_[k].id()];
+      int128 &v = assignment_[split_[k].id()];
+      if (v < info.hi) {
+        ++v;
+        break;
+      }
+      v = info.lo;
+    }
+    if (k == split_.size()) return true;
+  }
+}
+
+bool IntervalAnalyzer::prove(std::vector<expr> const& goals) {
+  return for_each_case([this, &goals] { return prove_case(goals); });
+}
+
+bool IntervalAnalyzer::infeasible_case() {
+  if (infeasible_) return true;
+  for (auto const& c : others_) {
+    if (formula(c) == Tri::kFalse) return true;
+  }
+  return infeasible_;
+}
+
+unsigned IntervalAnalyzer::width(
+    std::vector<expr> const& terms, unsigned limit) {
+  unsigned bits = 1;
+  bool fit = for_each_case([&] {
+    std::vector<Interval> ivs;
+    for (auto const& t : terms) ivs.push_back(term(t));
+    if (infeasible_case()) return true;
+    for (auto const& iv : ivs) {
+      while (bits < limit && (iv.lo < Interval::min_value(bits) ||
+                              iv.hi > Interval::max_value(bits))) {
+        ++bits;
+      }
+    }
+    return bits < limit;
+  });
+  return fit ? bits : limit;
+}
+
+bool IntervalAnalyzer::prove_case(std::vector<expr> const& goals) {
+  for (auto const& g : goals) {
+    if (formula(g) != Tri::kTrue) return infeasible_case();
+  }
+  return true;
+}
+
+Interval IntervalAnalyzer::symbol(expr const& e) {
+  unsigned w = e.get_sort().bv_size();
+  auto ait = assignment_.find(e.id());
+  if (ait != assignment_.end()) return Interval::point(ait->second, w);
+
+  Interval r = Interval::top(w);
+  auto sit = symbols_.find(e.id());
+  // Cyclic definitions are cut with the whole range.
+  if (sit == symbols_.end() || !visiting_.insert(e.id()).second) {
+    return r;
+  }
+  SymbolInfo const& info = sit->second;
+  for (auto const& b : info.lowers) {
+    r.lo = std::max(r.lo, term(b.e).lo + b.adjust);
+  }
+  for (auto const& b : info.uppers) {
+    r.hi = std::min(r.hi, term(b.e).hi - b.adjust);
+  }
+  for (auto const& d : info.defs) {
+    Interval t = term(d);
+    r.lo = std::max(r.lo, t.lo);
+    r.hi = std::min(r.hi, t.hi);
+  }
+  visiting_.erase(e.id());
+  if (r.empty()) infeasible_ = true;
+  return r;
+}
+
+Interval IntervalAnalyzer::term(expr const& e) {
+  auto it = terms_.find(e.id());
+  if (it != terms_.end()) return it->second;
+
+  unsigned w = e.get_sort().bv_size();
+  Interval r = Interval::top(w);
+  int128 v;
+  if (w > 64) {
+    // Keep the whole range.
+  } else if (bv_numeral(e, &v)) {
+    r = Interval::point(v, w);
+  } else if (is_symbol(e)) {
+    r = symbol(e);
+  } else if (e.is_app()) {
+    std::vector<Interval> args;
+    switch (e.decl().decl_kind()) {
+      case Z3_OP_ITE: {
+        Tri c = formula(e.arg(0));
+        if (c == Tri::kTrue) {
+          r = term(e.arg(1));
+        } else if (c == Tri::kFalse) {
+          r = term(e.arg(2));
+        } else {
+          std::vector<expr> cond{e.arg(0)};
+          Interval t = Interval::none(w), f = Interval::none(w);
+          assume(cond, true, [&] { t = term(e.arg(1)); });
+          assume(cond, false, [&] { f = term(e.arg(2)); });
+          if (t.empty()) r = f;
+          else if (f.empty()) r = t;
+          else r = {std::min(t.lo, f.lo), std::max(t.hi, f.hi), w};
+        }
+        break;
+      }
+      case Z3_OP_BADD: {
+        int128 lo = 0, hi = 0;
+        for (unsigned i = 0; i < e.num_args(); ++i) {
+          Interval a = term(e.arg(i));
+          lo += a.lo;
+          hi += a.hi;
+        }
+        r = Interval::fit(lo, hi, w);
+        break;
+      }
+      case Z3_OP_BSUB: {
+        Interval a = term(e.arg(0)), b = term(e.arg(1));
+        r = Interval::fit(a.lo - b.hi, a.hi - b.lo, w);
+        break;
+      }
+      case Z3_OP_BNEG: {
+        Interval a = term(e.arg(0));
+        r = Interval::fit(-a.hi, -a.lo, w);
+        break;
+      }
+      case Z3_OP_BMUL: {
+        r = term(e.arg(0));
+        for (unsigned i = 1; i < e.num_args(); ++i) {
+          Interval b = term(e.arg(i));
+          // Operands are fitted in 64 bits, product fits in 128.
+          r = Interval::hull(
+              {r.lo * b.lo, r.lo * b.hi, r.hi * b.lo, r.hi * b.hi}, w);
+        }
+        break;
+      }
+      case Z3_OP_BSHL: {
+        Interval a = term(e.arg(0)), k = term(e.arg(1));
+        if (k.lo < 0 || k.hi > 63 || k.hi >= w) break;
+        int128 p1 = int128(1) << k.lo, p2 = int128(1) << k.hi;
+        r = Interval::hull({a.lo * p1, a.lo * p2, a.hi * p1, a.hi * p2}, w);
+        break;
+      }
+      case Z3_OP_BLSHR:
+      case Z3_OP_BASHR: {
+        Interval a = term(e.arg(0)), k = term(e.arg(1));
+        bool logic = e.decl().decl_kind() == Z3_OP_BLSHR;
+        if (k.lo < 0 || (logic && a.lo < 0)) break;
+        int128 k1 = std::min<int128>(k.lo, w - 1);
+        int128 k2 = std::min<int128>(k.hi, w - 1);
+        r = Interval::hull({a.lo >> k1, a.lo >> k2,
+                            a.hi >> k1, a.hi >> k2}, w);
+        break;
+      }
+      case Z3_OP_BSDIV:
+      case Z3_OP_BSDIV_I: {
+        Interval a = term(e.arg(0)), b = term(e.arg(1));
+        if (b.empty()) break;
+        if (b.contains(0)) {
+          // |a / b| <= |a|, and z3 defines a / 0 as -1 or 1.
+          r = Interval::fit(std::min({a.lo, -a.hi, int128(-1)}),
+                            std::max({a.hi, -a.lo, int128(1)}), w);
+          break;
+        }
+        r = Interval::hull({a.lo / b.lo, a.lo / b.hi,
+                            a.hi / b.lo, a.hi / b.hi}, w);
+        break;
+      }
+      default:
+        break;
+    }
+  }
+  terms_.emplace(e.id(), r);
+  return r;
+}
+
+static void meet(std::unordered_map<unsigned, Interval> &env,
+                 expr const& e, Interval const& v) {
+  // Numerals are exact already.
+  if (e.is_numeral()) return;
+  auto it = env.find(e.id());
+  if (it == env.end()) {
+    env.emplace(e.id(), v);
+  } else {
+    it->second.lo = std::max(it->second.lo, v.lo);
+    it->second.hi = std::min(it->second.hi, v.hi);
+  }
+}
+
+bool IntervalAnalyzer::refine(
+    expr const& cond, bool value, Env &env) {
+  if (!cond.is_app()) return false;
+  Z3_decl_kind k = cond.decl().decl_kind();
+  if (k == Z3_OP_NOT) return refine(cond.arg(0), !value, env);
+  if (cond.num_args() != 2 || !cond.arg(0).is_bv()) return false;
+
+  // Normalize into `x <= y` or `x < y`.
+  bool strict = false, swap = false;
+  switch (k) {
+    case Z3_OP_SLEQ: break;
+    case Z3_OP_SLT: strict = true; break;
+    case Z3_OP_SGEQ: swap = true; break;
+    case Z3_OP_SGT: swap = true; strict = true; break;
+    case Z3_OP_EQ: {
+      if (!value) return false;
+      Interval a = term(cond.arg(0)), b = term(cond.arg(1));
+      Interval m = {std::max(a.lo, b.lo), std::min(a.hi, b.hi), a.width};
+      meet(env, cond.arg(0), m);
+      meet(env, cond.arg(1), m);
+      return true;
+    }
+    default: return false;
+  }
+  if (!value) {
+    // not (x <= y) is y < x, not (x < y) is y <= x.
+    strict = !strict;
+    swap = !swap;
+  }
+  expr x = cond.arg(swap ? 1 : 0), y = cond.arg(swap ? 0 : 1);
+  Interval a = term(x), b = term(y);
+  int128 s = strict ? 1 : 0;
+  meet(env, x, Interval{a.lo, std::min(a.hi, b.hi - s), a.width});
+  meet(env, y, Interval{std::max(b.lo, a.lo + s), b.hi, b.width});
+  return true;
+}
+
+template<typename F>
+bool IntervalAnalyzer::assume(
+    std::vector<expr> const& conds, bool value, F const& eval) {
+  Env env;
+  bool refined = false;
+  if (depth_ < kMaxBranchDepth) {
+    for (auto const& c : conds) refined = refine(c, value, env) || refined;
+  }
+  if (!refined) {
+    eval();
+    return true;
+  }
+  for (auto const& it : env) {
+    if (it.second.empty()) return false;
+  }
+
+  // Evaluate in a fresh scope, since memo of enclosing scope
+  //  doesn't know the refined operands. Any empty interval met
+  //  in the scope means the assumption is infeasible.
+  std::unordered_map<unsigned, Interval> terms(env);
+  std::unordered_map<unsigned, Tri> formulas;
+  std::unordered_set<unsigned> visiting;
+  bool infeasible = infeasible_;
+  terms_.swap(terms);
+  formulas_.swap(formulas);
+  visiting_.swap(visiting);
+  infeasible_ = false;
+  ++depth_;
+
+  eval();
+  bool feasible = !infeasible_;
+
+  --depth_;
+  terms_.swap(terms);
+  formulas_.swap(formulas);
+  visiting_.swap(visiting);
+  infeasible_ = infeasible;
+  return feasible;
+}
+
+Tri IntervalAnalyzer::formula(expr const& e) {
+  if (e.is_true()) return Tri::kTrue;
+  if (e.is_false()) return Tri::kFalse;
+  if (!e.is_app()) return Tri::kUnknown;
+  auto it = formulas_.find(e.id());
+  if (it != formulas_.end()) return it->second;
+
+  Tri r = Tri::kUnknown;
+  switch (e.decl().decl_kind()) {
+    case Z3_OP_AND: {
+      r = Tri::kTrue;
+      for (unsigned i = 0; i < e.num_args() && r != Tri::kFalse; ++i) {
+        Tri t = formula(e.arg(i));
+        if (t != Tri::kTrue) r = t;
+      }
+      break;
+    }
+    case Z3_OP_OR: {
+      r = Tri::kFalse;
+      for (unsigned i = 0; i < e.num_args() && r != Tri::kTrue; ++i) {
+        Tri t = formula(e.arg(i));
+        if (t != Tri::kFalse) r = t;
+      }
+      break;
+    }
+    case Z3_OP_NOT:
+      r = tri_not(formula(e.arg(0)));
+      break;
+    case Z3_OP_IMPLIES: {
+      Tri a = formula(e.arg(0));
+      if (a == Tri::kFalse) {
+        r = Tri::kTrue;
+        break;
+      }
+      Tri b = formula(e.arg(1));
+      if (b == Tri::kTrue) {
+        r = Tri::kTrue;
+      } else if (a == Tri::kTrue) {
+        r = b;
+      } else {
+        // Check the consequent under antecedent.
+        std::vector<expr> conds;
+        flatten_and(e.arg(0), conds);
+        Tri c = Tri::kUnknown;
+        if (!assume(conds, true, [&] { c = formula(e.arg(1)); }) ||
+            c == Tri::kTrue) {
+          r = Tri::kTrue;
+        }
+      }
+      break;
+    }
+    case Z3_OP_SLEQ:
+    case Z3_OP_SLT:
+    case Z3_OP_SGEQ:
+    case Z3_OP_SGT: {
+      Z3_decl_kind k = e.decl().decl_kind();
+      bool swap = k == Z3_OP_SGEQ || k == Z3_OP_SGT;
+      bool strict = k == Z3_OP_SLT || k == Z3_OP_SGT;
+      Interval a = term(e.arg(swap ? 1 : 0));
+      Interval b = term(e.arg(swap ? 0 : 1));
+      // a <= b, or a < b if strict.
+      if (strict ? a.hi < b.lo : a.hi <= b.lo) r = Tri::kTrue;
+      else if (strict ? a.lo >= b.hi : a.lo > b.hi) r = Tri::kFalse;
+      break;
+    }
+    case Z3_OP_EQ: {
+      if (e.arg(0).id() == e.arg(1).id()) {
+        r = Tri::kTrue;
+      } else if (e.arg(0).is_bv()) {
+        Interval a = term(e.arg(0)), b = term(e.arg(1));
+        if (a.is_point() && b.is_point() && a.lo == b.lo) r = Tri::kTrue;
+        else if (a.hi < b.lo || b.hi < a.lo) r = Tri::kFalse;
+      } else if (e.arg(0).is_bool()) {
+        Tri a = formula(e.arg(0)), b = formula(e.arg(1));
+        if (a != Tri::kUnknown && b != Tri::kUnknown) r = tri(a == b);
+      }
+      break;
+    }
+    case Z3_OP_ITE: {
+      Tri c = formula(e.arg(0));
+      if (c != Tri::kUnknown) {
+        r = formula(e.arg(c == Tri::kTrue ? 1 : 2));
+      } else {
+        Tri t = formula(e.arg(1)), f = formula(e.arg(2));
+        if (t == f) r = t;
+      }
+      break;
+    }
+    case Z3_OP_BSMUL_NO_OVFL:
+    case Z3_OP_BSMUL_NO_UDFL: {
+      Interval a = term(e.arg(0)), b = term(e.arg(1));
+      unsigned w = a.width;
+      std::vector<int128> vs{a.lo * b.lo, a.lo * b.hi,
+                             a.hi * b.lo, a.hi * b.hi};
+      int128 lo = *std::min_element(vs.begin(), vs.end());
+      int128 hi = *std::max_element(vs.begin(), vs.end());
+      if (e.decl().decl_kind() == Z3_OP_BSMUL_NO_OVFL) {
+        if (hi <= Interval::max_value(w)) r = Tri::kTrue;
+        else if (lo > Interval::max_value(w)) r = Tri::kFalse;
+      } else {
+        if (lo >= Interval::min_value(w)) r = Tri::kTrue;
+        else if (hi < Interval::min_value(w)) r = Tri::kFalse;
+      }
+      break;
+    }
+    default:
+      break;
+  }
+  formulas_.emplace(e.id(), r);
+  return r;
+}
+
+bool interval_discharge(expr const& cstr) {
+  if (cstr.is_true()) return true;
+  if (!cstr.is_app() ||
+      cstr.decl().decl_kind() != Z3_OP_IMPLIES) return false;
+
+  std::vector<expr> facts, goals;
+  flatten_and(cstr.arg(0), facts);
+  flatten_and(cstr.arg(1), goals);
+  return IntervalAnalyzer(facts).prove(goals);
+}
+
+// Post-order of distinct sub-terms, children first.
+static void collect_terms(expr const& root, std::vector<expr> &terms) {
+  std::unordered_set<unsigned> seen;
+  std::vector<std::pair<expr, bool> > stack{{root, false}};
+  while (!stack.empty()) {
+    expr e = stack.back().first;
+    bool expanded = stack.back().second;
+    stack.pop_back();
+    if (expanded) {
+      terms.push_back(e);
+      continue;
+    }
+    if (seen.count(e.id())) continue;
+    seen.insert(e.id());
+    stack.push_back({e, true});
+    if (!e.is_app()) continue;
+    for (unsigned i = e.num_args(); i > 0; --i) {
+      if (!seen.count(e.arg(i - 1).id())) {
+        stack.push_back({e.arg(i - 1), false});
+      }
+    }
+  }
+}
+
+/*
+ * Rebuild the term over bit-vectors of width w, the args are
+ *  rebuilt already. Returns false on operator which doesn't
+ *  commute with truncation.
+ **/
+static bool narrow_app(expr const& e, std::vector<expr> const& args,
+                       unsigned w, unsigned width, expr *r) {
+  context &ctx = e.ctx();
+  if (e.is_bv() && e.is_numeral()) {
+    int128 v;
+    if (!bv_numeral(e, &v)) return false;
+    *r = ctx.bv_val(static_cast<int64_t>(v), w);
+    return true;
+  }
+  if (is_symbol(e)) {
+    if (e.is_bool()) *r = e;
+    else if (e.is_bv()) *r = ctx.constant(e.decl().name(), ctx.bv_sort(w));
+    else return false;
+    return true;
+  }
+  if (e.is_true() || e.is_false()) {
+    *r = e;
+    return true;
+  }
+  if (!e.is_app()) return false;
+
+  expr_vector vs(ctx);
+  for (auto const& a : args) vs.push_back(a);
+  switch (e.decl().decl_kind()) {
+    case Z3_OP_AND: *r = mk_and(vs); break;
+    case Z3_OP_OR: *r = mk_or(vs); break;
+    case Z3_OP_NOT: *r = !args[0]; break;
+    case Z3_OP_IMPLIES: *r = implies(args[0], args[1]); break;
+    case Z3_OP_EQ: *r = args[0] == args[1]; break;
+    case Z3_OP_ITE: *r = ite(args[0], args[1], args[2]); break;
+    case Z3_OP_SLEQ: *r = args[0] <= args[1]; break;
+    case Z3_OP_SLT: *r = args[0] < args[1]; break;
+    case Z3_OP_SGEQ: *r = args[0] >= args[1]; break;
+    case Z3_OP_SGT: *r = args[0] > args[1]; break;
+    case Z3_OP_BADD:
+    case Z3_OP_BMUL: {
+      bool add = e.decl().decl_kind() == Z3_OP_BADD;
+      *r = args[0];
+      for (size_t i = 1; i < args.size(); ++i) {
+        *r = add ? *r + args[i] : *r * args[i];
+      }
+      break;
+    }
+    case Z3_OP_BSUB: *r = args[0] - args[1]; break;
+    case Z3_OP_BNEG: *r = -args[0]; break;
+    case Z3_OP_BSHL: *r = shl(args[0], args[1]); break;
+    case Z3_OP_BASHR: *r = ashr(args[0], args[1]); break;
+    case Z3_OP_BLSHR: *r = lshr(args[0], args[1]); break;
+    case Z3_OP_BSDIV: *r = args[0] / args[1]; break;
+    case Z3_OP_BSMUL_NO_OVFL:
+    case Z3_OP_BSMUL_NO_UDFL:
+      // Product of w bits operands always fits in width bits.
+      if (2 * w > width) return false;
+      *r = ctx.bool_val(true);
+      break;
+    default:
+      return false;
+  }
+  return true;
+}
+
+unsigned narrow_width(expr const& cstr, expr *narrowed) {
+  if (!cstr.is_app() ||
+      cstr.decl().decl_kind() != Z3_OP_IMPLIES) return 0;
+
+  std::vector<expr> terms, bvs;
+  collect_terms(cstr, terms);
+  unsigned width = 0;
+  for (auto const& t : terms) {
+    if (!t.is_bv()) continue;
+    unsigned w = t.get_sort().bv_size();
+    // Mixed widths come from extension or extraction.
+    if (width != 0 && w != width) return 0;
+    width = w;
+    bvs.push_back(t);
+  }
+  if (width == 0 || width > 64) return 0;
+
+  std::vector<expr> facts;
+  flatten_and(cstr.arg(0), facts);
+  // At least one value bit besides the sign.
+  unsigned w = std::max(2u, IntervalAnalyzer(facts).width(bvs, width));
+  if (w >= width) return 0;
+
+  // Terms are in post-order, so the args are rebuilt already.
+  std::unordered_map<unsigned, expr> rebuilt;
+  for (auto const& t : terms) {
+    std::vector<expr> args;
+    for (unsigned i = 0; t.is_app() && i < t.num_args(); ++i) {
+      args.push_back(rebuilt.at(t.arg(i).id()));
+    }
+    expr r(cstr.ctx());
+    if (!narrow_app(t, args, w, width, &r)) return 0;
+    rebuilt.emplace(t.id(), r);
+  }
+  *narrowed = rebuilt.at(cstr.id());
+  return w;
+}
+
+}
+}
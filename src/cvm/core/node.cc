@@ -1,4 +1,6 @@
+#include <map>
 #include <memory>
+#include <string>
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
@@ -15,67 +17,61 @@ using namespace type;
 
 NodeAssertions& NodeAssertions::add_input(
     TypePtr const& tp) {
-  in_cstr = in_cstr && 
-    tp->data_constraints() &&
-    tp->prec_constraints();
+  in_cstr.add(tp->data_constraints())
+    .add(tp->prec_constraints());
   return *this;
 }
 
 NodeAssertions& NodeAssertions::add_input(
     TypePtr const& tp, size_t index) {
-  in_cstr = in_cstr && 
-    tp->data_constraints(index) &&
-    tp->prec_constraints();
+  in_cstr.add(tp->data_constraints(index))
+    .add(tp->prec_constraints());
   return *this;
 }
 
 NodeAssertions& NodeAssertions::add_input(
     TypePtr const& tp, 
-    std::vector<size_t> indexes) {
+    std::vector<size_t> const& indexes) {
   for (size_t index : indexes) {
-    in_cstr = in_cstr && tp->data_constraints(index);
+    in_cstr.add(tp->data_constraints(index));
   }
-  in_cstr = in_cstr && tp->prec_constraints();
+  in_cstr.add(tp->prec_constraints());
   return *this;
 }
 
 NodeAssertions& NodeAssertions::add_extra_constraint(
     z3_expr const& c) {
-  in_cstr = in_cstr && c;
+  in_cstr.add(c);
   return *this;
 }
 
 NodeAssertions& NodeAssertions::add_output(
     type::TypePtr const& tp) {
-  in_cstr = in_cstr && 
-    tp->assign_constraints() &&
-    tp->prec_constraints();
-  out_cstr = out_cstr &&
-    tp->data_constraints() &&
-    tp->op_constraints();
+  in_cstr.add(tp->assign_constraints())
+    .add(tp->prec_constraints());
+  out_cstr.add(tp->data_constraints())
+    .add(tp->op_constraints());
   return *this;
 }
 
 NodeAssertions& NodeAssertions::add_output(
     type::TypePtr const& tp, size_t index) {
-  in_cstr = in_cstr &&
-    tp->assign_constraints(index) &&
-    tp->prec_constraints();
-  out_cstr = out_cstr &&
-    tp->data_constraints(index) &&
-    tp->op_constraints(index);
+  in_cstr.add(tp->assign_constraints(index))
+    .add(tp->prec_constraints());
+  out_cstr.add(tp->data_constraints(index))
+    .add(tp->op_constraints(index));
   return *this;
 }
 
 NodeAssertions& NodeAssertions::merge(NodeAssertions const& t) {
-  in_cstr = in_cstr && t.in_cstr;
-  out_cstr = out_cstr && t.out_cstr;
+  in_cstr.add(t.in_cstr);
+  out_cstr.add(t.out_cstr);
   unique_id = t.unique_id;
   return *this;
 }
 
 z3_expr NodeAssertions::provement_generator() const {
-  return type::implies(in_cstr, out_cstr);
+  return type::implies(in_cstr.to_expr(), out_cstr.to_expr());
 }
 
 Node::~Node() {
@@ -167,6 +163,7 @@ void Node::infer_precision() {
       nas_[i][j].merge(nas[i]);
     }
   }
+  shared_nas_ = std::move(nas);
 }
 
 void Node::forward() {
@@ -184,23 +181,146 @@ void Node::forward() {
     << " vs. " << data_.size();
 }
 
-std::vector<z3_expr> 
-Node::provements_generator(bool unique) {
-  std::vector<z3_expr> proves;
-  std::unordered_set<size_t> uid_set;
+ObligationCursor::ObligationCursor(
+    std::vector<std::vector<NodeAssertions> > const& nas,
+    bool unique, std::vector<bool> const& skip)
+  : nas_(nas), skip_(skip), unique_(unique) {}
+
+bool ObligationCursor::next(z3_expr *obligation) {
   // Iterator over number of outputs.
-  for (auto it = nas_.begin(); it != nas_.end(); ++it) {
-    std::vector<NodeAssertions> out = *it;
-    for (auto oit = out.begin();oit != out.end(); ++oit) {
-      if (unique && // And not inserted successfully via exists
-          !uid_set.insert(oit->get_uid()).second) 
+  for (; output_ < nas_.size(); ++output_, index_ = 0) {
+    std::vector<NodeAssertions> const& out = nas_[output_];
+    while (index_ < out.size()) {
+      size_t index = index_++;
+      if (output_ == 0 && index < skip_.size() && skip_[index])
         continue;
-      proves.push_back(oit->provement_generator());
+      if (unique_ && // And not inserted successfully via exists
+          !uid_set_.insert(out[index].get_uid()).second)
+        continue;
+      *obligation = out[index].provement_generator();
+      return true;
     }
   }
+  return false;
+}
+
+ObligationCursor Node::obligations(bool unique,
+                                   std::vector<bool> const& skip) const {
+  return ObligationCursor(nas_, unique, skip);
+}
+
+std::vector<z3_expr> 
+Node::provements_generator(bool unique,
+                           std::vector<bool> const& skip) {
+  std::vector<z3_expr> proves;
+  ObligationCursor cursor = obligations(unique, skip);
+  z3_expr p(true);
+  while (cursor.next(&p)) proves.push_back(p);
   return proves;
 }
 
+void Node::release() {
+  // Swapped out, so that the capacity is freed too.
+  std::vector<NodeEntry>().swap(inputs);
+  std::vector<TypePtr>().swap(data_);
+  std::vector<std::vector<NodeAssertions> >().swap(nas_);
+  std::vector<NodeAssertions>().swap(shared_nas_);
+}
+
+std::vector<bool> Node::compositional_discharge() {
+  if (is_variable() || op()->compositional == nullptr) return {};
+  std::vector<TypePtr> in_data(inputs.size());
+  for (size_t i = 0; i < in_data.size(); ++i) {
+    in_data[i] = inputs[i].operator->();
+  }
+  return op()->compositional(attrs, in_data, data_, background());
+}
+
+z3_expr Node::background() {
+  z3_conj bg;
+  for (auto &e : inputs) {
+    TypePtr const& tp = e.node->data_[e.index];
+    bg.add(tp->prec_constraints()).add(tp->range_constraints());
+  }
+  for (auto &tp : data_) {
+    bg.add(tp->prec_assign_constraints())
+      .add(tp->prec_constraints())
+      .add(tp->range_constraints());
+  }
+  for (auto &na : shared_nas_) {
+    bg.add(na.in_constraints());
+  }
+  return bg.to_expr();
+}
+
+// Attribute value without spaces, tuple as parentheses.
+static std::string canonical_attr(std::string const& v) {
+  if (v == "True") return "true";
+  if (v == "False") return "false";
+  std::string s;
+  for (char c : v) {
+    if (c == ' ' || c == '\t') continue;
+    if (c == '[') c = '(';
+    else if (c == ']') c = ')';
+    s.push_back(c);
+  }
+  return s;
+}
+
+std::string Node::signature() {
+  if (is_variable()) return "";
+  std::string sig = op()->name;
+  // Sorted by key.
+  std::map<std::string, std::string> dict(
+      attrs.dict.begin(), attrs.dict.end());
+  for (auto const& kv : dict) {
+    sig += ";" + kv.first + "=" + canonical_attr(kv.second);
+  }
+  std::vector<TypeRef const*> tensors;
+  std::vector<unsigned> prec_ids;
+  for (auto &e : inputs) {
+    TypePtr const& tp = e.node->data_[e.index];
+    sig += "|" + tp->shape.to_string();
+    // Aliased data, such as the same tensor fed twice.
+    size_t alias = std::find(tensors.begin(), tensors.end(), tp.get()) -
+      tensors.begin();
+    tensors.push_back(tp.get());
+    sig += "@" + std::to_string(alias);
+
+    // Constant data, such as the weights bound from params, are
+    //  named by the param tensor, which is the variable name.
+    //  Other numeral data are kept by all the values.
+    if (e.node->is_variable()) {
+      if (tp->Size() > 0 && tp->at(0).data.is_numeral()) {
+        sig += "#" + e.node->attrs.name;
+      }
+    } else {
+      size_t i = 0;
+      while (i < tp->Size() && !tp->at(i).data.is_numeral()) ++i;
+      if (i < tp->Size()) {
+        sig += "#";
+        for (i = 0; i < tp->Size(); ++i) {
+          expr const& v = tp->at(i).data;
+          sig += (v.is_numeral() ? v.get_decimal_string(0) : "*") + ",";
+        }
+      }
+    }
+
+    expr p = tp->prec.data;
+    if (p.is_numeral()) {
+      sig += ":" + p.to_string();
+    } else if (p.is_const()) {
+      alias = std::find(prec_ids.begin(), prec_ids.end(), p.id()) -
+        prec_ids.begin();
+      prec_ids.push_back(p.id());
+      sig += ":*" + std::to_string(alias);
+    } else {
+      // Kept as is, equal only with the same symbols.
+      sig += ":" + p.to_string();
+    }
+  }
+  return sig;
+}
 
 }
 }
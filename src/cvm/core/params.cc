@@ -0,0 +1,163 @@
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cvm/base.h"
+#include "cvm/params.h"
+
+namespace z3 {
+namespace cvm {
+
+static const uint64_t kListMagic = 0xF7E58D4F05049CB7;
+static const uint64_t kArrayMagic = 0xDD5E40F096B4A13F;
+// DLDataTypeCode of signed integer.
+static const uint8_t kDLInt = 0;
+
+int64_t ParamTensor::at(size_t index) const {
+  const char *p = data + index * (bits / 8);
+  switch (bits) {
+    case 8: return *reinterpret_cast<const int8_t*>(p);
+    case 16: { int16_t v; memcpy(&v, p, sizeof(v)); return v; }
+    case 32: { int32_t v; memcpy(&v, p, sizeof(v)); return v; }
+    default: break;
+  }
+  int64_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+/*
+ * Reader of the mapped bytes, every read is checked against the
+ *  end of file.
+ **/
+class ParamsReader {
+ public:
+  ParamsReader(const char *data, size_t size, std::string const& path)
+    : data_(data), size_(size), path_(path) {}
+
+  template<typename T>
+  T read() {
+    T v;
+    memcpy(&v, skip(sizeof(T)), sizeof(T));
+    return v;
+  }
+
+  const char* skip(size_t n) {
+    VERIFY(n <= size_ - pos_) << "truncated params file: " << path_;
+    const char *p = data_ + pos_;
+    pos_ += n;
+    return p;
+  }
+
+ private:
+  const char *data_;
+  size_t size_;
+  size_t pos_{0};
+  std::string const& path_;
+};
+
+Params::Params(const std::string &path) : path_(path) {
+  // The destructor isn't run if the constructor throws.
+  try {
+    load();
+  } catch (...) {
+    release();
+    throw;
+  }
+}
+
+Params::~Params() {
+  release();
+}
+
+void Params::release() {
+  if (map_ != nullptr) munmap(const_cast<char*>(map_), map_size_);
+  if (fd_ >= 0) close(fd_);
+  map_ = nullptr;
+  fd_ = -1;
+}
+
+void Params::load() {
+  const std::string &path = path_;
+  fd_ = open(path.c_str(), O_RDONLY);
+  VERIFY(fd_ >= 0) << "cannot open params file: " << path
+    << ", " << strerror(errno);
+
+  struct stat st;
+  VERIFY_EQ(fstat(fd_, &st), 0) << "cannot stat params file: " << path;
+  size_t size = st.st_size;
+  VERIFY(size >= 2 * sizeof(uint64_t))
+    << "truncated params file header: " << path;
+  void *addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd_, 0);
+  VERIFY(addr != MAP_FAILED) << "cannot map params file: " << path;
+  map_ = static_cast<const char*>(addr);
+  map_size_ = size;
+
+  ParamsReader reader(map_, map_size_, path_);
+  VERIFY_EQ(reader.read<uint64_t>(), kListMagic)
+    << "not a params file: " << path;
+  reader.read<uint64_t>();
+
+  uint64_t num_names = reader.read<uint64_t>();
+  std::vector<std::string> names;
+  for (uint64_t i = 0; i < num_names; ++i) {
+    uint64_t length = reader.read<uint64_t>();
+    std::string name(reader.skip(length), length);
+    if (name.compare(0, 4, "arg:") == 0) name = name.substr(4);
+    names.push_back(std::move(name));
+  }
+  uint64_t num_arrays = reader.read<uint64_t>();
+  VERIFY_EQ(num_arrays, num_names)
+    << "params file has " << num_names << " names and "
+    << num_arrays << " arrays: " << path;
+  for (auto const& name : names) {
+    VERIFY_EQ(reader.read<uint64_t>(), kArrayMagic)
+      << "invalid array " << name << " in params file: " << path;
+    reader.read<uint64_t>();
+    reader.skip(2 * sizeof(int32_t));
+    int32_t ndim = reader.read<int32_t>();
+    uint8_t code = reader.read<uint8_t>();
+    uint8_t bits = reader.read<uint8_t>();
+    uint16_t lanes = reader.read<uint16_t>();
+    VERIFY(code == kDLInt && lanes == 1 &&
+           (bits == 8 || bits == 16 || bits == 32 || bits == 64))
+      << "param " << name << " is not integer, dtype code "
+      << int(code) << " bits " << int(bits) << " lanes " << lanes;
+    VERIFY(ndim >= 0) << "param " << name << " has ndim " << ndim;
+
+    // Dims are bounded by the int32 of Shape, and the size in
+    //  bytes is computed without wrapping.
+    ParamTensor t;
+    t.bits = bits;
+    uint64_t expected = bits / 8;
+    bool overflow = false;
+    for (int32_t d = 0; d < ndim; ++d) {
+      int64_t dim = reader.read<int64_t>();
+      VERIFY(dim >= 0 && dim <= INT32_MAX)
+        << "param " << name << " has dim " << d << " of " << dim;
+      t.shape.push_back(dim);
+      overflow |= __builtin_mul_overflow(expected, uint64_t(dim), &expected);
+    }
+    int64_t num_bytes = reader.read<int64_t>();
+    VERIFY(num_bytes >= 0 && !overflow &&
+           static_cast<uint64_t>(num_bytes) == expected)
+      << "param " << name << " of shape " << t.shape.to_string()
+      << " has " << num_bytes << " bytes";
+    t.data = reader.skip(num_bytes);
+    index_[name] = t;
+  }
+}
+
+const ParamTensor* Params::find(const std::string &name) const {
+  auto it = index_.find(name);
+  return it == index_.end() ? nullptr : &it->second;
+}
+
+}
+}
@@ -0,0 +1,150 @@
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cvm/base.h"
+#include "cvm/canonical.h"
+#include "cvm/proof_cache.h"
+
+namespace z3 {
+namespace cvm {
+
+static const char kMagic[8] = {'C', 'V', 'M', 'P', 'R', 'O', 'O', 'F'};
+static const uint32_t kFormatVersion = 2;
+
+struct FileHeader {
+  char magic[8];
+  uint32_t format;
+  uint32_t reserved;
+};
+
+// Followed by `model_size` bytes of counterexample.
+struct RecordHeader {
+  uint64_t key;
+  uint64_t check;
+  uint32_t status;
+  uint32_t model_size;
+  double time;
+};
+
+ProofCache::ProofCache(const std::string &path) : path_(path) {
+  fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+  VERIFY(fd_ >= 0) << "cannot open proof cache: " << path
+    << ", " << strerror(errno);
+
+  struct stat st;
+  VERIFY_EQ(fstat(fd_, &st), 0) << "cannot stat proof cache: " << path;
+  size_t size = st.st_size;
+  if (size == 0) {
+    FileHeader header;
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.format = kFormatVersion;
+    header.reserved = 0;
+    VERIFY_EQ(write(fd_, &header, sizeof(header)),
+              (ssize_t)sizeof(header))
+      << "cannot write proof cache: " << path;
+    return;
+  }
+
+  VERIFY(size >= sizeof(FileHeader))
+    << "truncated proof cache header: " << path;
+  void *addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd_, 0);
+  VERIFY(addr != MAP_FAILED) << "cannot map proof cache: " << path;
+  map_ = static_cast<const char*>(addr);
+  map_size_ = size;
+
+  FileHeader header;
+  memcpy(&header, map_, sizeof(header));
+  VERIFY(memcmp(header.magic, kMagic, sizeof(kMagic)) == 0)
+    << "not a proof cache file: " << path;
+  VERIFY_EQ(header.format, kFormatVersion)
+    << "unsupported proof cache format " << header.format
+    << " in " << path;
+
+  size_t offset = sizeof(FileHeader);
+  while (offset + sizeof(RecordHeader) <= size) {
+    RecordHeader rec;
+    memcpy(&rec, map_ + offset, sizeof(rec));
+    size_t next = offset + sizeof(rec) + rec.model_size;
+    if (next > size) break;
+    // Later record wins, which is the same verdict anyway.
+    index_[rec.key] = offset;
+    offset = next;
+  }
+  if (offset < size) {
+    // Drop the torn tail so that appending stays aligned.
+    VERIFY_EQ(ftruncate(fd_, offset), 0)
+      << "cannot truncate proof cache: " << path;
+  }
+}
+
+ProofCache::~ProofCache() {
+  if (map_ != nullptr) munmap(const_cast<char*>(map_), map_size_);
+  if (fd_ >= 0) close(fd_);
+}
+
+uint64_t ProofCache::OpTag(const Op *op) {
+  if (op == nullptr) return 0;
+  uint64_t h = hash_bytes(op->name.data(), op->name.size());
+  return hash_combine(h, op->version);
+}
+
+bool ProofCache::find(ProofKey const& key, ProveResult *res) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto ait = appended_.find(key.hash);
+  if (ait != appended_.end()) {
+    if (ait->second.first != key.check) return false;
+    *res = ait->second.second;
+    return true;
+  }
+  auto it = index_.find(key.hash);
+  if (it == index_.end()) return false;
+
+  RecordHeader rec;
+  memcpy(&rec, map_ + it->second, sizeof(rec));
+  if (rec.check != key.check) return false;
+  res->status = static_cast<ProveStatus>(rec.status);
+  res->time = rec.time;
+  res->model.assign(map_ + it->second + sizeof(rec), rec.model_size);
+  return true;
+}
+
+void ProofCache::insert(ProofKey const& key, ProveResult const& res) {
+  if (res.status == ProveStatus::kUnprovable) return;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  // The first record of colliding hash is kept.
+  if (appended_.count(key.hash) || index_.count(key.hash)) return;
+
+  RecordHeader rec;
+  memset(&rec, 0, sizeof(rec));
+  rec.key = key.hash;
+  rec.check = key.check;
+  rec.status = static_cast<uint32_t>(res.status);
+  rec.model_size = res.model.size();
+  rec.time = res.time;
+  std::string buf(reinterpret_cast<const char*>(&rec), sizeof(rec));
+  buf += res.model;
+  // Single write with O_APPEND, so records of concurrent
+  //  processes are not interleaved.
+  VERIFY_EQ(write(fd_, buf.data(), buf.size()), (ssize_t)buf.size())
+    << "cannot append proof cache: " << path_;
+
+  appended_[key.hash].first = key.check;
+  ProveResult &stored = appended_[key.hash].second;
+  stored.status = res.status;
+  stored.time = res.time;
+  stored.model = res.model;
+}
+
+size_t ProofCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return index_.size() + appended_.size();
+}
+
+}
+}
@@ -0,0 +1,916 @@
+#include <chrono>
+#include <climits>
+#include <sstream>
+#include <algorithm>
+#include <unordered_map>
+#include <thread>
+
+#include "z3++.h"
+#include "z3_api.h"
+
+#include "cvm/prover.h"
+#include "cvm/bounded_queue.h"
+#include "cvm/canonical.h"
+#include "cvm/discharge.h"
+#include "cvm/proof_cache.h"
+#include "cvm/node.h"
+
+namespace z3 {
+namespace cvm {
+
+using namespace type;
+
+static const char* status_name(ProveStatus status) {
+  switch (status) {
+    case ProveStatus::kDeterministic: return "deterministic";
+    case ProveStatus::kUndeterministic: return "undeterministic";
+    case ProveStatus::kUnprovable: return "unprovable";
+  }
+  return "";
+}
+
+static ProveStep make_step(
+    std::string const& name, unsigned timeout, unsigned rlimit,
+    std::string const& tactic, bool split) {
+  ProveStep step;
+  step.name = name;
+  step.timeout = timeout;
+  step.rlimit = rlimit;
+  step.tactic = tactic;
+  step.split = split;
+  return step;
+}
+
+ProveLadder default_ladder(unsigned timeout, unsigned rlimit) {
+  if (timeout == 0 && rlimit == 0) return {};
+  auto part = [](unsigned budget, unsigned n) {
+    return budget == 0 ? 0 : std::max(1U, budget / n);
+  };
+  // Integer obligations are nonlinear with multiplication.
+  std::string tactic = GetTheory() == Theory::kInteger ?
+    "simplify;solve-eqs;qfnia" : "simplify;solve-eqs;bit-blast;sat";
+  return {
+    make_step("quick", part(timeout, 10), part(rlimit, 10), "", false),
+    make_step("tactic", part(timeout, 4), part(rlimit, 4), tactic, false),
+    make_step("split", part(timeout, 4), part(rlimit, 4), "", true),
+    make_step("final", timeout, rlimit, "", false),
+  };
+}
+
+ProveLadder default_portfolio(unsigned timeout, unsigned rlimit) {
+  if (GetTheory() == Theory::kInteger) {
+    return {
+      make_step("qflia", timeout, rlimit, "simplify;solve-eqs;qflia", false),
+      make_step("qfnia", timeout, rlimit, "simplify;solve-eqs;qfnia", false),
+      make_step("smt", timeout, rlimit,
+                "simplify;propagate-values;solve-eqs;smt", false),
+      make_step("default", timeout, rlimit, "", false),
+    };
+  }
+  return {
+    make_step("bit-blast", timeout, rlimit,
+              "simplify;solve-eqs;bit-blast;sat", false),
+    make_step("qfbv", timeout, rlimit, "qfbv", false),
+    make_step("smt", timeout, rlimit,
+              "simplify;propagate-values;solve-eqs;smt", false),
+    make_step("default", timeout, rlimit, "", false),
+  };
+}
+
+void ProveResult::report(std::ostream &os) const {
+  os << "===== Z3_PROVER =====\n"
+    << smt
+    << "===== END =====\n" << std::endl;
+  std::string msg;
+  switch (status) {
+    case ProveStatus::kDeterministic:
+      msg = "The model is deterministic"; break;
+    case ProveStatus::kUndeterministic:
+      msg = "The model is undeterministic"; break;
+    case ProveStatus::kUnprovable:
+      msg = "The model is unprovable"; break;
+  }
+  os << msg << std::endl;
+  if (&os != &std::cout) std::cout << msg << std::endl;
+  if (method != "z3") os << "Discharged by: " << method << std::endl;
+  if (!strategy.empty()) os << "Strategy: " << strategy << std::endl;
+  for (auto const& a : attempts) {
+    os << "Attempt " << a.step << ": " << status_name(a.status)
+      << " in " << a.time << "s";
+    if (!a.reason.empty()) os << " (" << a.reason << ")";
+    os << std::endl;
+  }
+  os << model;
+  os << "Time: " << time << "s" << std::endl;
+}
+
+bool ProveResult::rebuild(context &ctx, z3::model *m) const {
+  if (values.empty()) return false;
+  *m = z3::model(ctx);
+  for (auto const& v : values) {
+    symbol name = v.int_symbol ?
+      ctx.int_symbol(v.number) : ctx.str_symbol(v.name.c_str());
+    sort s = v.kind == Z3_BV_SORT ? ctx.bv_sort(v.bv_size) :
+      v.kind == Z3_INT_SORT ? ctx.int_sort() : ctx.bool_sort();
+    expr val = v.kind == Z3_BV_SORT ?
+      ctx.bv_val(v.value.c_str(), v.bv_size) :
+      v.kind == Z3_INT_SORT ? ctx.int_val(v.value.c_str()) :
+      ctx.bool_val(v.value == "true");
+    func_decl f = ctx.function(name, 0, nullptr, s);
+    m->add_const_interp(f, val);
+  }
+  return true;
+}
+
+/*
+ * Constants of model, the numerals of bool, integer and
+ *  bit-vector sorts, which are all the symbols of obligations.
+ **/
+static std::vector<ModelValue> model_values(model const& m) {
+  std::vector<ModelValue> values;
+  for (unsigned i = 0; i < m.num_consts(); ++i) {
+    func_decl d = m.get_const_decl(i);
+    expr val = m.get_const_interp(d);
+    ModelValue v;
+    v.kind = d.range().sort_kind();
+    if (v.kind == Z3_BOOL_SORT && (val.is_true() || val.is_false())) {
+      v.value = val.is_true() ? "true" : "false";
+    } else if ((v.kind == Z3_INT_SORT || v.kind == Z3_BV_SORT) &&
+               val.is_numeral()) {
+      v.value = val.get_decimal_string(0);
+      if (v.kind == Z3_BV_SORT) v.bv_size = d.range().bv_size();
+    } else {
+      continue;
+    }
+    symbol name = d.name();
+    v.int_symbol = name.kind() == Z3_INT_SYMBOL;
+    if (v.int_symbol) {
+      v.number = name.to_int();
+    } else {
+      v.name = name.str();
+    }
+    values.push_back(std::move(v));
+  }
+  return values;
+}
+
+static expr negate(expr const& cstr) {
+  if (GetSimplifyLevel() <= 6) return !cstr;
+  return (!cstr).simplify();
+}
+
+/*
+ * Check the negation of cstr with solver, the caller is
+ *  responsible for adding the goal into solver.
+ **/
+static ProveResult check(solver &s, std::string *reason = nullptr) {
+  ProveResult res;
+  auto start = std::chrono::steady_clock::now();
+  check_result r = unknown;
+  try {
+    r = s.check();
+  } catch (exception const& e) {
+    // Tactic may fail on unsupported fragment, which is
+    //  regarded as unknown and escalated.
+    if (reason) *reason = e.msg();
+  }
+  switch (r) {
+    case unsat:
+      res.status = ProveStatus::kDeterministic;
+      break;
+    case sat: {
+      res.status = ProveStatus::kUndeterministic;
+      // Racer of portfolio may be interrupted after check returns.
+      try {
+        model m = s.get_model();
+        std::ostringstream mss;
+        for (unsigned i = 0; i < m.size(); i++) {
+          func_decl v = m[i];
+          mss << SymbolTable::Get()->name(v.name()) << " = ";
+          if (v.arity() == 0)
+            mss << m.get_const_interp(v);
+          else
+            mss << m.get_func_interp(v);
+          mss << "\n";
+        }
+        res.model = mss.str();
+        res.values = model_values(m);
+      } catch (exception const& e) {
+        res.status = ProveStatus::kUnprovable;
+        if (reason) *reason = e.msg();
+      }
+      break;
+    }
+    case unknown:
+      res.status = ProveStatus::kUnprovable;
+      if (reason && reason->empty()) *reason = s.reason_unknown();
+      break;
+  }
+  std::chrono::duration<double> interval =
+    std::chrono::steady_clock::now() - start;
+  res.time = interval.count();
+  return res;
+}
+
+static solver make_solver(context &ctx, ProveStep const& step) {
+  if (step.tactic.empty()) return solver(ctx);
+  std::istringstream iss(step.tactic);
+  std::string name;
+  std::unique_ptr<tactic> t;
+  while (std::getline(iss, name, ';')) {
+    if (name.empty()) continue;
+    if (t) t.reset(new tactic(*t & tactic(ctx, name.c_str())));
+    else t.reset(new tactic(ctx, name.c_str()));
+  }
+  VERIFY(t) << "empty tactic of step " << step.name;
+  return t->mk_solver();
+}
+
+static params make_params(context &ctx, ProveStep const& step) {
+  params p(ctx);
+  // UINT_MAX and zero are the unlimited defaults of z3.
+  p.set("timeout", step.timeout == 0 ? UINT_MAX : step.timeout);
+  p.set("rlimit", step.rlimit);
+  return p;
+}
+
+/*
+ * Check goal, i.e. the negation of obligation, under budget of
+ *  step. Steps with the default solver reuse the incremental
+ *  session if any.
+ **/
+static ProveResult check_step(
+    context &ctx, ProveStep const& step,
+    expr const& background, expr const& goal,
+    solver *session, std::string *reason) {
+  if (session != nullptr && step.tactic.empty()) {
+    session->set(make_params(ctx, step));
+    session->push();
+    session->add(goal);
+    ProveResult res = check(*session, reason);
+    session->pop();
+    return res;
+  }
+  solver s = make_solver(ctx, step);
+  s.set(make_params(ctx, step));
+  if (!background.is_true()) s.add(background);
+  s.add(goal);
+  return check(s, reason);
+}
+
+/*
+ * Decompose `implies(in, a && b && ...)` into `implies(in, a)`,
+ *  `implies(in, b)`, ..., the obligation holds iff all the
+ *  parts hold, and the counterexample of any part is the one
+ *  of the whole. Small parts help if one output conjunct is
+ *  hard and drags the whole bit-blasted circuit.
+ **/
+static ProveResult check_split(
+    context &ctx, ProveStep const& step,
+    expr const& background, expr const& cstr,
+    solver *session, std::string *reason) {
+  std::vector<expr> outs;
+  if (cstr.is_app() && cstr.decl().decl_kind() == Z3_OP_IMPLIES) {
+    flatten_and(cstr.arg(1), outs);
+  }
+  if (outs.size() < 2) {
+    return check_step(ctx, step, background, negate(cstr),
+                      session, reason);
+  }
+
+  // Budget is shared by all the parts: wall time via deadline,
+  //  and resource evenly.
+  auto start = std::chrono::steady_clock::now();
+  ProveStep part = step;
+  if (step.rlimit != 0) {
+    part.rlimit = std::max<unsigned>(1, step.rlimit / outs.size());
+  }
+
+  ProveResult res;
+  res.status = ProveStatus::kDeterministic;
+  for (auto const& o : outs) {
+    if (step.timeout != 0) {
+      std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+      if (elapsed.count() >= step.timeout) {
+        res.status = ProveStatus::kUnprovable;
+        *reason = "timeout";
+        break;
+      }
+      part.timeout = std::max(1U,
+          step.timeout - static_cast<unsigned>(elapsed.count()));
+    }
+    std::string part_reason;
+    ProveResult r = check_step(
+        ctx, part, background, negate(implies(cstr.arg(0), o)),
+        session, &part_reason);
+    res.time += r.time;
+    if (r.status == ProveStatus::kUndeterministic) {
+      res.status = r.status;
+      res.model = r.model;
+      res.values = r.values;
+      reason->clear();
+      break;
+    } else if (r.status == ProveStatus::kUnprovable) {
+      // The step has failed, leave the rest to next step.
+      res.status = r.status;
+      *reason = part_reason;
+      break;
+    }
+  }
+  return res;
+}
+
+static ProveResult escalate(
+    context &ctx, expr const& background, expr const& cstr,
+    ProveLadder const& ladder, solver *session) {
+  ProveResult res;
+  for (auto const& step : ladder) {
+    ProveAttempt attempt;
+    ProveResult r = step.split ?
+      check_split(ctx, step, background, cstr,
+                  session, &attempt.reason) :
+      check_step(ctx, step, background, negate(cstr),
+                 session, &attempt.reason);
+    attempt.step = step.name;
+    attempt.status = r.status;
+    attempt.time = r.time;
+    res.attempts.push_back(attempt);
+
+    res.status = r.status;
+    res.model = r.model;
+    res.values = r.values;
+    res.time += r.time;
+    if (r.status != ProveStatus::kUnprovable) break;
+  }
+  return res;
+}
+
+ProveResult prove_in_context(context &ctx, expr const& cstr,
+                             ProveLadder const& ladder) {
+  solver s(ctx);
+  s.add(negate(cstr));
+  std::ostringstream oss;
+  oss << s;
+
+  ProveResult res = ladder.empty() ?
+    check(s) : escalate(ctx, ctx.bool_val(true), cstr, ladder, nullptr);
+  res.smt = oss.str();
+  return res;
+}
+
+/*
+ * The default solver falls back to the generic smt core once
+ *  push is invoked, while QF_BV logic solver bit-blasts into
+ *  the incremental sat solver, which keeps the circuits and
+ *  learned clauses across scopes. Recursive helper functions
+ *  are out of QF_BV, only used with lower SIMPLIFY_LEVEL.
+ *  Integer obligations have no such logic solver.
+ **/
+static solver session_solver(context &ctx) {
+  if (GetSimplifyLevel() <= 4 ||
+      GetTheory() == Theory::kInteger) return solver(ctx);
+  return solver(ctx, "QF_BV");
+}
+
+ProveSession::ProveSession(context &ctx, expr const& background,
+                           ProveLadder const& ladder)
+  : solver_(session_solver(ctx)), background_(background), ladder_(ladder) {
+  if (GetSimplifyLevel() > 6) background_ = background_.simplify();
+  solver_.add(background_);
+}
+
+ProveResult ProveSession::prove(expr const& cstr) {
+  // Only dump the goal, the background is asserted once.
+  expr goal = negate(cstr);
+  std::ostringstream oss;
+  oss << "(assert " << goal << ")\n";
+
+  ProveResult res;
+  if (ladder_.empty()) {
+    solver_.push();
+    solver_.add(goal);
+    res = check(solver_);
+    solver_.pop();
+  } else {
+    res = escalate(solver_.ctx(), background_, cstr, ladder_, &solver_);
+  }
+  res.smt = oss.str();
+  return res;
+}
+
+Portfolio::Portfolio(ProveLadder const& strategies)
+  : strategies_(strategies) {
+  for (size_t i = 0; i < strategies_.size(); ++i) {
+    contexts_.emplace_back(new context);
+    InitContext(*contexts_.back());
+  }
+}
+
+Portfolio::~Portfolio() {
+  for (auto &ctx : contexts_) ReleaseContext(*ctx);
+}
+
+ProveResult Portfolio::prove(
+    context &ctx, expr const& background, expr const& cstr) {
+  size_t n = strategies_.size();
+  std::vector<expr> cstrs, bgs;
+  for (auto &c : contexts_) {
+    cstrs.push_back(expr(*c, Z3_translate(ctx, cstr, *c)));
+    bgs.push_back(expr(*c, Z3_translate(ctx, background, *c)));
+  }
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::vector<ProveResult> results(n);
+  std::vector<std::string> reasons(n);
+  std::vector<bool> finished(n, false);
+  size_t num_finished = 0;
+  int winner = -1;
+
+  std::vector<std::thread> threads;
+  for (size_t k = 0; k < n; ++k) {
+    threads.emplace_back([&, k] {
+      ProveResult r;
+      try {
+        r = check_step(
+            *contexts_[k], strategies_[k], bgs[k], negate(cstrs[k]),
+            nullptr, &reasons[k]);
+      } catch (exception const& e) {
+        // Interrupted before entering check, such as simplify.
+        reasons[k] = e.msg();
+      }
+      std::lock_guard<std::mutex> lock(mutex);
+      results[k] = std::move(r);
+      finished[k] = true;
+      ++num_finished;
+      if (winner < 0 &&
+          results[k].status != ProveStatus::kUnprovable) {
+        winner = k;
+      }
+      cv.notify_all();
+    });
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&] { return winner >= 0 || num_finished == n; });
+    // Interrupt is lost if the racer has not entered check yet,
+    //  so keep interrupting until all the racers return.
+    while (num_finished < n) {
+      for (size_t k = 0; k < n; ++k) {
+        if (!finished[k]) contexts_[k]->interrupt();
+      }
+      cv.wait_for(lock, std::chrono::milliseconds(10));
+    }
+  }
+  for (auto &t : threads) t.join();
+
+  ProveResult res;
+  if (winner >= 0) {
+    res = results[winner];
+    res.strategy = strategies_[winner].name;
+  } else {
+    for (auto const& r : results) res.time = std::max(res.time, r.time);
+  }
+  for (size_t k = 0; k < n; ++k) {
+    ProveAttempt attempt;
+    attempt.step = strategies_[k].name;
+    attempt.status = results[k].status;
+    attempt.time = results[k].time;
+    attempt.reason = reasons[k];
+    res.attempts.push_back(attempt);
+  }
+  return res;
+}
+
+Prover::Prover(size_t num_workers) {
+  if (num_workers == 0) {
+    num_workers = std::max(1U, std::thread::hardware_concurrency());
+  }
+  for (size_t i = 0; i < num_workers; ++i) {
+    workers_.emplace_back(new Worker);
+  }
+  for (auto &w : workers_) {
+    w->thread = std::thread(&Prover::run, this, w.get());
+  }
+}
+
+Prover::~Prover() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  task_cv_.notify_all();
+  for (auto &w : workers_) w->thread.join();
+}
+
+static bool same_steps(ProveLadder const& a, ProveLadder const& b) {
+  if (a.size() != b.size()) return false;
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (a[i].name != b[i].name || a[i].tactic != b[i].tactic ||
+        a[i].timeout != b[i].timeout || a[i].rlimit != b[i].rlimit) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Prover& Prover::set_portfolio(ProveLadder const& strategies) {
+  // Workers rebuild their racer contexts once strategies change.
+  if (!same_steps(portfolio_, strategies)) {
+    portfolio_ = strategies;
+    ++portfolio_version_;
+  }
+  return *this;
+}
+
+std::vector<ProveResult> Prover::prove(
+    std::vector<z3_expr> const& proves) {
+  return prove(proves, z3_expr(true));
+}
+
+std::vector<ProveResult> Prover::prove(
+    std::vector<z3_expr> const& proves,
+    z3_expr const& background,
+    const Op *op) {
+  SimplifyScope scope(op ? op->simplify_level : -1);
+  uint64_t tag = ProofCache::OpTag(op);
+  size_t n = proves.size();
+  std::vector<size_t> reps(n);
+  std::vector<ProofKey> keys(n);
+  bool has_background = !background.cstr.is_true();
+  // Obligations of a session are only equivalent under the same
+  //  background, so the key falls back to the named structure.
+  ProofKey bg_key;
+  if (cache_ && has_background) {
+    bg_key.hash = structural_hash(background.cstr);
+    bg_key.check = structural_hash(background.cstr, ProofCache::kCheckSeed);
+  }
+  std::vector<ProveResult> results(n);
+  std::vector<bool> discharged(n, false);
+  std::unordered_map<unsigned, size_t> classes;
+  // Hold the canonical forms of classes, since ast id may be
+  //  recycled after the ast is released.
+  std::vector<CanonicalForm> forms;
+  for (size_t i = 0; i < n; ++i) {
+    reps[i] = i;
+    const char *pass = nullptr;
+    if (syntactic_ && syntactic_discharge(proves[i].cstr)) {
+      pass = "syntactic";
+    } else if (interval_ && interval_discharge(proves[i].cstr)) {
+      pass = "interval";
+    }
+    if (pass != nullptr) {
+      discharged[i] = true;
+      results[i].status = ProveStatus::kDeterministic;
+      results[i].smt = std::string("; discharged by ") + pass + "\n";
+      results[i].method = pass;
+      continue;
+    }
+    if (!canonical_ && !cache_) continue;
+    // Renaming symbols apart from the shared background breaks
+    //  the equivalence, so obligations of session aren't grouped.
+    if (has_background) {
+      if (cache_) {
+        expr const& cstr = proves[i].cstr;
+        keys[i].hash = hash_combine(
+            hash_combine(structural_hash(cstr), bg_key.hash), tag);
+        keys[i].check = hash_combine(hash_combine(
+              structural_hash(cstr, ProofCache::kCheckSeed),
+              bg_key.check), tag);
+      }
+      continue;
+    }
+
+    CanonicalForm form(proves[i].cstr);
+    if (canonical_) {
+      auto it = classes.emplace(form.id(), i);
+      reps[i] = it.first->second;
+      if (it.second) forms.push_back(form);
+    }
+    if (cache_) {
+      keys[i].hash = hash_combine(form.hash(), tag);
+      keys[i].check = hash_combine(form.hash(ProofCache::kCheckSeed), tag);
+    }
+  }
+
+  std::vector<z3_expr> pending;
+  std::vector<size_t> slots;
+  for (size_t i = 0; i < n; ++i) {
+    if (reps[i] != i || discharged[i]) continue;
+    if (cache_ && cache_->find(keys[i], &results[i])) {
+      results[i].smt = "; proof cache hit\n";
+      results[i].method = "cache";
+      continue;
+    }
+    slots.push_back(i);
+    pending.push_back(proves[i]);
+  }
+
+  // Session obligations share the background of full width.
+  std::vector<unsigned> widths(pending.size(), 0);
+  if (adaptive_width_ && !has_background) {
+    for (size_t k = 0; k < pending.size(); ++k) {
+      expr narrowed(C);
+      widths[k] = narrow_width(pending[k].cstr, &narrowed);
+      if (widths[k] != 0) pending[k] = z3_expr(z3_cstr(narrowed));
+    }
+  }
+
+  std::vector<ProveResult> solved = dispatch(pending, background);
+  std::vector<z3_expr> recheck;
+  std::vector<size_t> rechecked;
+  for (size_t k = 0; k < solved.size(); ++k) {
+    if (widths[k] == 0) continue;
+    if (solved[k].status == ProveStatus::kUndeterministic) {
+      // Narrowed model may not be a model of original.
+      recheck.push_back(proves[slots[k]]);
+      rechecked.push_back(k);
+    } else {
+      solved[k].smt = "; width " + std::to_string(widths[k]) +
+        "\n" + solved[k].smt;
+    }
+  }
+  if (!recheck.empty()) {
+    std::vector<ProveResult> confirmed = dispatch(recheck, background);
+    for (size_t j = 0; j < rechecked.size(); ++j) {
+      solved[rechecked[j]] = std::move(confirmed[j]);
+    }
+  }
+  for (size_t k = 0; k < slots.size(); ++k) {
+    results[slots[k]] = std::move(solved[k]);
+    if (cache_) cache_->insert(keys[slots[k]], results[slots[k]]);
+    if (!portfolio_.empty()) {
+      std::string const& winner = results[slots[k]].strategy;
+      portfolio_wins_[op ? op->name : ""]
+        [winner.empty() ? "none" : winner]++;
+    }
+  }
+
+  for (size_t i = 0; i < n; ++i) {
+    if (reps[i] != i) {
+      ProveResult const& rep = results[reps[i]];
+      results[i].status = rep.status;
+      // Values name the symbols of representative, not replayed.
+      results[i].model = rep.model;
+      results[i].smt = "; alpha-equivalent to obligation #" +
+        std::to_string(reps[i]) + "\n";
+      results[i].method = "canonical";
+    }
+    results[i].representative = reps[i];
+  }
+  return results;
+}
+
+std::vector<ProveResult> Prover::dispatch(
+    std::vector<z3_expr> const& proves,
+    z3_expr const& background) {
+  std::vector<ProveResult> results(proves.size());
+  if (proves.empty()) return results;
+  // Without background, every obligation uses a fresh solver.
+  bool incremental = !background.cstr.is_true();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    batch_ = &proves;
+    background_ = incremental ? &background : nullptr;
+    results_ = &results;
+    next_ = 0;
+    active_ = workers_.size();
+    ++generation_;
+  }
+  task_cv_.notify_all();
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_cv_.wait(lock, [this] { return active_ == 0; });
+  batch_ = nullptr;
+  background_ = nullptr;
+  results_ = nullptr;
+  return results;
+}
+
+/*
+ * Back off of polling the queues of stream, yields at first and
+ *  then sleeps, so that the idle threads don't hold the cpu.
+ **/
+static void backoff(unsigned *spins) {
+  if (++*spins < 16) {
+    std::this_thread::yield();
+  } else {
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+  }
+}
+
+struct Prover::Stream {
+  struct Task {
+    size_t index{0};
+    // Obligation in the global context, which is released under
+    //  Z3ContextMutex.
+    std::unique_ptr<expr> cstr;
+  };
+  struct Done {
+    size_t index{0};
+    ProveResult result;
+  };
+
+  // Results in flight are bounded by the tasks queued and the
+  //  ones being checked by workers.
+  Stream(size_t capacity, size_t num_workers)
+    : tasks(capacity), done(tasks.capacity() + num_workers) {}
+
+  utils::BoundedQueue<Task> tasks;
+  utils::BoundedQueue<Done> done;
+  std::atomic<bool> producing{true};
+};
+
+size_t Prover::prove_stream(
+    ObligationCursor &cursor,
+    z3_expr const& background,
+    std::function<void(ProveResult const&)> const& report,
+    const Op *op,
+    size_t capacity) {
+  SimplifyScope scope(op ? op->simplify_level : -1);
+  Stream stream(capacity, workers_.size());
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stream_ = &stream;
+    background_ = background.cstr.is_true() ? nullptr : &background;
+    active_ = workers_.size();
+    ++generation_;
+  }
+  task_cv_.notify_all();
+
+  // Results checked ahead of the previous obligations wait in
+  //  the reorder buffer.
+  std::map<size_t, ProveResult> ahead;
+  size_t count = 0, reported = 0;
+  auto collect = [&]() {
+    Stream::Done done;
+    while (stream.done.try_pop(&done)) {
+      ahead.emplace(done.index, std::move(done.result));
+    }
+    for (auto it = ahead.begin();
+         it != ahead.end() && it->first == reported;
+         it = ahead.erase(it)) {
+      if (!portfolio_.empty() && it->second.method == "z3") {
+        std::string const& winner = it->second.strategy;
+        portfolio_wins_[op ? op->name : ""]
+          [winner.empty() ? "none" : winner]++;
+      }
+      report(it->second);
+      ++reported;
+    }
+  };
+
+  while (true) {
+    Stream::Task task;
+    const char *pass = nullptr;
+    {
+      // Workers translate from the global context meanwhile.
+      std::lock_guard<std::mutex> lock(Z3ContextMutex());
+      z3_expr p(true);
+      if (!cursor.next(&p)) break;
+      if (syntactic_ && syntactic_discharge(p.cstr)) {
+        pass = "syntactic";
+      } else if (interval_ && interval_discharge(p.cstr)) {
+        pass = "interval";
+      } else {
+        task.cstr.reset(new expr(p.cstr));
+      }
+    }
+    task.index = count++;
+    if (pass != nullptr) {
+      ProveResult &res = ahead[task.index];
+      res.status = ProveStatus::kDeterministic;
+      res.smt = std::string("; discharged by ") + pass + "\n";
+      res.method = pass;
+      res.representative = task.index;
+    } else {
+      // Back pressure, the full queue blocks building.
+      unsigned spins = 0;
+      while (!stream.tasks.try_push(task)) {
+        collect();
+        backoff(&spins);
+      }
+    }
+    collect();
+  }
+  stream.producing.store(false, std::memory_order_release);
+
+  unsigned spins = 0;
+  while (collect(), reported < count) backoff(&spins);
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_cv_.wait(lock, [this] { return active_ == 0; });
+  stream_ = nullptr;
+  background_ = nullptr;
+  return count;
+}
+
+expr Prover::translate(Worker *w, WorkerState *s, expr const& cstr) {
+  // Wrap translated ast immediately, since reference count
+  //  of the raw ast is not held by the worker context.
+  if (background_ != nullptr && !s->has_background) {
+    s->background = expr(w->ctx,
+        Z3_translate(C, background_->cstr, w->ctx));
+    s->has_background = true;
+  }
+  return expr(w->ctx, Z3_translate(C, cstr, w->ctx));
+}
+
+ProveResult Prover::check(Worker *w, WorkerState *s, expr const& cstr) {
+  if (!portfolio_.empty()) {
+    ProveResult res = w->portfolio->prove(
+        w->ctx, s->has_background ?
+        s->background : w->ctx.bool_val(true), cstr);
+    std::ostringstream oss;
+    oss << "(assert " << negate(cstr) << ")\n";
+    res.smt = oss.str();
+    return res;
+  }
+  if (s->has_background && !s->session) {
+    s->session.reset(new ProveSession(w->ctx, s->background, ladder_));
+  }
+  return s->session ?
+    s->session->prove(cstr) : prove_in_context(w->ctx, cstr, ladder_);
+}
+
+void Prover::drain(Worker *w, WorkerState *s) {
+  Stream::Task task;
+  unsigned spins = 0;
+  while (true) {
+    if (!stream_->tasks.try_pop(&task)) {
+      // The last obligation is pushed before producing is reset,
+      //  so the queue is checked once more before leaving.
+      if (stream_->producing.load(std::memory_order_acquire)) {
+        backoff(&spins);
+        continue;
+      }
+      if (!stream_->tasks.try_pop(&task)) break;
+    }
+    spins = 0;
+    expr cstr(w->ctx);
+    {
+      std::lock_guard<std::mutex> lock(Z3ContextMutex());
+      cstr = translate(w, s, *task.cstr);
+      task.cstr.reset();
+    }
+    Stream::Done done;
+    done.index = task.index;
+    done.result = check(w, s, cstr);
+    done.result.representative = task.index;
+    while (!stream_->done.try_push(done)) backoff(&spins);
+  }
+}
+
+void Prover::run(Worker *w) {
+  // Helper functions must be declared before any translation,
+  //  since recursive function definitions are context local.
+  InitContext(w->ctx);
+
+  uint64_t seen = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      task_cv_.wait(lock, [this, seen] {
+        return stop_ || generation_ != seen;
+      });
+      if (stop_) break;
+      seen = generation_;
+    }
+
+    if (!portfolio_.empty() &&
+        (!w->portfolio || w->portfolio_version != portfolio_version_)) {
+      w->portfolio.reset(new Portfolio(portfolio_));
+      w->portfolio_version = portfolio_version_;
+    }
+    {
+      // Session is created lazily, workers without any
+      //  obligation taken skip the background translation.
+      WorkerState state(w->ctx);
+      if (stream_ != nullptr) {
+        drain(w, &state);
+      } else {
+        size_t i;
+        while ((i = next_++) < batch_->size()) {
+          expr cstr(w->ctx);
+          {
+            std::lock_guard<std::mutex> lock(Z3ContextMutex());
+            cstr = translate(w, &state, batch_->at(i).cstr);
+          }
+          (*results_)[i] = check(w, &state, cstr);
+        }
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--active_ == 0) done_cv_.notify_all();
+    }
+  }
+
+  w->portfolio.reset();
+  ReleaseContext(w->ctx);
+}
+
+}
+}
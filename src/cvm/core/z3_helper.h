@@ -1,6 +1,11 @@
 #ifndef Z3_FUNC_H
 #define Z3_FUNC_H
 
+#include <limits>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
 #include "z3++.h"
 #include "cvm/z3_types.h"
 
@@ -25,51 +30,158 @@ namespace type {
 //  data in CVM executor is Int32 placeholder.
 static const int32_t _INT_PLACE_HOLDER = 64;
 
-static expr _Int(const char *n) { return C.bv_const(n, _INT_PLACE_HOLDER); }
+static bool _IsInteger() { return GetTheory() == Theory::kInteger; }
+
+static sort _IntSort(context &ctx) {
+  return _IsInteger() ? ctx.int_sort() : ctx.bv_sort(_INT_PLACE_HOLDER);
+}
+static expr _Int(context &ctx, const char *n) {
+  return ctx.constant(n, _IntSort(ctx));
+}
+// Constant of integer symbol, see SymbolTable.
+static expr _IntSym(context &ctx, int id, sort const& s) {
+  return expr(ctx, Z3_mk_const(ctx, Z3_mk_int_symbol(ctx, id), s));
+}
+static expr _IntVal(context &ctx, int64_t val) {
+  return _IsInteger() ? ctx.int_val(val) : ctx.bv_val(val, 64);
+}
+
+static expr _Int(const char *n) { return _Int(C, n); }
 static expr _Int(const std::string &n) { return _Int(n.c_str()); }
-static expr _IntVal(int32_t val) { return C.bv_val(val, 64); }
-static bool _IsInt(expr val) { return val.is_bv(); }
-static sort _IntSort() { return C.bv_sort(_INT_PLACE_HOLDER); }
+static expr _IntVal(int32_t val) { return _IntVal(C, val); }
+static bool _IsInt(expr val) { return _IsInteger() ? val.is_int() : val.is_bv(); }
+static sort _IntSort() { return _IntSort(C); }
 static expr _BoolVal(bool val) { return C.bool_val(val); }
 static bool _IsBool(expr val) { return val.is_bool(); }
 
+/*
+ * Integer encodings of shift, the amount is constrained into
+ *  [0, 31] by operator constraints, so the shift is unrolled
+ *  into linear cases of constant power, instead of nonlinear
+ *  power of z3. Out of range amount gives the value of shift
+ *  beyond 64 bits.
+ **/
+static const int32_t _INT_MAX_SHIFT = 31;
+
+static expr _IntPow2(const expr &b) {
+  context &ctx = b.ctx();
+  expr r = _IntVal(ctx, 0);
+  for (int32_t k = _INT_MAX_SHIFT; k >= 0; --k) {
+    r = z3::ite(b == k, _IntVal(ctx, int64_t{1} << k), r);
+  }
+  return r;
+}
+static expr _IntShl(const expr &a, const expr &b) {
+  context &ctx = a.ctx();
+  expr r = _IntVal(ctx, 0);
+  for (int32_t k = _INT_MAX_SHIFT; k >= 0; --k) {
+    r = z3::ite(b == k, a * _IntVal(ctx, int64_t{1} << k), r);
+  }
+  return r;
+}
+static expr _IntShr(const expr &a, const expr &b) {
+  context &ctx = a.ctx();
+  // Integer division rounds down with positive divisor.
+  expr r = z3::ite(a < 0, _IntVal(ctx, -1), _IntVal(ctx, 0));
+  for (int32_t k = _INT_MAX_SHIFT; k >= 0; --k) {
+    r = z3::ite(b == k, a / _IntVal(ctx, int64_t{1} << k), r);
+  }
+  return r;
+}
+// Bit-vector division truncates toward zero.
+static expr _IntDiv(const expr &a, const expr &b) {
+  expr q = z3::ite(a >= 0, a, -a) / z3::ite(b >= 0, b, -b);
+  return z3::ite((a >= 0) == (b >= 0), q, -q);
+}
+// Bit-vector operators never overflow in the range.
+static expr _IntRange(const expr &v) {
+  context &ctx = v.ctx();
+  return (_IntVal(ctx, std::numeric_limits<int64_t>::min()) <= v) &&
+    (v <= _IntVal(ctx, std::numeric_limits<int64_t>::max()));
+}
+
 /*
  * Helper function defined in z3_func mode.
+ *
+ * The declarations are context local, and recursive function
+ *  must be defined in the context before any expression using
+ *  it is translated into, so the declarations are cached and
+ *  built once per context.
  **/
-static func_decl func_bit_range() {
-  expr a = _Int("a"), b = _Int("b");
-  sort I = _IntSort();
-  z3::func_decl f = C.recfun("bit_range", I, I);
-  expr_vector args(C);
+using func_decl_builder = func_decl (*)(context&);
+using func_decl_table = std::unordered_map<std::string, func_decl>;
+
+static std::mutex& _DeclCacheMutex() {
+  static std::mutex inst;
+  return inst;
+}
+static std::unordered_map<Z3_context, func_decl_table>& _DeclCache() {
+  static std::unordered_map<Z3_context, func_decl_table> inst;
+  return inst;
+}
+
+static func_decl _ContextDecl(
+    context &ctx, const char *key, func_decl_builder builder) {
+  std::lock_guard<std::mutex> lock(_DeclCacheMutex());
+  func_decl_table &table = _DeclCache()[ctx];
+  // Declarations are overloaded by the sort of theory.
+  std::string name = std::string(_IsInteger() ? "int:" : "bv:") + key;
+  auto it = table.find(name);
+  if (it == table.end()) {
+    it = table.emplace(name, builder(ctx)).first;
+  }
+  return it->second;
+}
+
+static void _ReleaseContextDecl(context &ctx) {
+  std::lock_guard<std::mutex> lock(_DeclCacheMutex());
+  _DeclCache().erase(ctx);
+}
+
+static func_decl func_bit_range(context &ctx) {
+  expr a = _Int(ctx, "a");
+  sort I = _IntSort(ctx);
+  z3::func_decl f = ctx.recfun("bit_range", I, I);
+  expr_vector args(ctx);
   args.push_back(a);
-  C.recdef(f, args,
+  ctx.recdef(f, args, _IsInteger() ?
+      _IntPow2(a-1) - 1 :
       (z3::shl(1, a-1) - 1));
   return f;
 }
 
-static func_decl func_safe_div() {
-  expr a = _Int("a"), b = _Int("b");
-  sort I = _IntSort();
-  z3::func_decl f = C.recfun("safe_div", I, I, I);
-  expr_vector args(C);
+static func_decl func_safe_div(context &ctx) {
+  expr a = _Int(ctx, "a");
+  expr b = _Int(ctx, "b");
+  sort I = _IntSort(ctx);
+  z3::func_decl f = ctx.recfun("safe_div", I, I, I);
+  expr_vector args(ctx);
   args.push_back(a);
   args.push_back(b);
-  C.recdef(f, args,
-      z3::ite(b == 0, _IntVal(0), a / b));
+  ctx.recdef(f, args,
+      z3::ite(b == 0, _IntVal(ctx, 0),
+        _IsInteger() ? _IntDiv(a, b) : a / b));
   return f;
 }
 
-static func_decl func_get_bit() {
-  expr a = _Int("a");
-  sort I = _IntSort();
-  z3::func_decl f = C.recfun("get_bit", I, I);
-  expr_vector args(C);
+static func_decl func_get_bit(context &ctx) {
+  expr a = _Int(ctx, "a");
+  sort I = _IntSort(ctx);
+  z3::func_decl f = ctx.recfun("get_bit", I, I);
+  expr_vector args(ctx);
   args.push_back(a);
-  C.recdef(f, args,
-      z3::ite(a == 0, _IntVal(0), f(z3::ashr(a, 1)) + 1));
+  ctx.recdef(f, args,
+      z3::ite(a == 0, _IntVal(ctx, 0),
+        f(_IsInteger() ? _IntShr(a, _IntVal(ctx, 1)) : z3::ashr(a, 1)) + 1));
   return f;
 }
 
+static void _InitContextDecl(context &ctx) {
+  _ContextDecl(ctx, "bit_range", func_bit_range);
+  _ContextDecl(ctx, "safe_div", func_safe_div);
+  _ContextDecl(ctx, "get_bit", func_get_bit);
+}
+
 /*
  * Wrapper function for z3 operator such as +,-,*,/ ...etc.
  *  And generating consistent constraints binding into
@@ -80,19 +192,22 @@ static expr _Add(const expr &a, const expr &b) { return a + b; }
 static expr _Sub(const expr &a, const expr &b) { return a - b; }
 static expr _Mul(const expr &a, const expr &b) { return a * b; }
 static expr _Div(const expr &a, const expr &b) { 
-#if SIMPLIFY_LEVEL <= 4
-  static func_decl safe_div = func_safe_div();
-  return safe_div(a, b);
-#else
-  return z3::ite(b == 0, _IntVal(0), a / b);
-#endif
+  if (GetSimplifyLevel() <= 4)
+    return _ContextDecl(a.ctx(), "safe_div", func_safe_div)(a, b);
+  return z3::ite(b == 0, _IntVal(0), _IsInteger() ? _IntDiv(a, b) : a / b);
 }
 static expr _Neg(const expr &a) { return -a; }
 
 
-static expr _OneShl(const expr &a) { return z3::shl(1, a); }
-static expr _Shr(const expr &a, const expr &b) { return z3::ashr(a, b); }
-static expr _Shl(const expr &a, const expr &b) { return z3::shl(a, b); }
+static expr _OneShl(const expr &a) {
+  return _IsInteger() ? _IntPow2(a) : z3::shl(1, a);
+}
+static expr _Shr(const expr &a, const expr &b) {
+  return _IsInteger() ? _IntShr(a, b) : z3::ashr(a, b);
+}
+static expr _Shl(const expr &a, const expr &b) {
+  return _IsInteger() ? _IntShl(a, b) : z3::shl(a, b);
+}
 
 /*
  * Must use operator >, since z3::max use bitvector 
@@ -113,34 +228,39 @@ static expr _Ite(const expr &c, const expr &t, const expr &e) {
 }
 
 static expr _func_BitRange(const expr &a) {
-  static func_decl one_shift = func_bit_range();
-  return one_shift(a);
+  return _ContextDecl(a.ctx(), "bit_range", func_bit_range)(a);
 }
 
 static expr _func_GetBit(const expr &a) {
-  static func_decl get_bit = func_get_bit();
-  return get_bit(a);
+  return _ContextDecl(a.ctx(), "get_bit", func_get_bit)(a);
 }
 
 /*
  * All operator constraints is to avoid overflow or underflow.
  **/
 static expr _AddCstr(const expr &a, const expr &b) {
+  if (_IsInteger()) return _IntRange(a + b);
   return (z3::bvadd_no_overflow(a, b, true) &&
           z3::bvadd_no_underflow(a, b)); 
 }
 static expr _SubCstr(const expr &a, const expr &b) {
+  if (_IsInteger()) return _IntRange(a - b);
   return (z3::bvsub_no_underflow(a, b, true) &&
           z3::bvsub_no_overflow(a, b)); 
 }
 static expr _MulCstr(const expr &a, const expr &b) {
+  if (_IsInteger()) return _IntRange(a * b);
   return (z3::bvmul_no_overflow(a, b, true) &&
           z3::bvmul_no_underflow(a, b)); 
 }
 static expr _DivCstr(const expr &a, const expr &b) { 
+  if (_IsInteger()) return _IntRange(-a) || (b != -1);
   return z3::bvsdiv_no_overflow(a, b); 
 }
-static expr _NegCstr(const expr &a) { return z3::bvneg_no_overflow(a); }
+static expr _NegCstr(const expr &a) {
+  if (_IsInteger()) return _IntRange(-a);
+  return z3::bvneg_no_overflow(a);
+}
 
 static expr _OneShlCstr(const expr &a) { return (0 <= a) && (a <= 31); }
 static expr _ShrCstr(const expr &a, const expr &b) {
@@ -154,7 +274,7 @@ static expr _MaxCstr(const expr &a, const expr &b) { return _BoolVal(true); }
 static expr _MinCstr(const expr &a, const expr &b) { return _BoolVal(true); }
 
 // Do strong constraints, since positive number may not overflow.
-static expr _AbsCstr(const expr &a) { return z3::bvneg_no_overflow(a); }
+static expr _AbsCstr(const expr &a) { return _NegCstr(a); }
 static expr _IteCstr(const expr &c, const expr &t, const expr &e) {
   return _BoolVal(true);
 }
@@ -1,3 +1,8 @@
+#include <atomic>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
 #include "z3++.h"
 #include "z3_api.h"
 
@@ -13,6 +18,102 @@ context& Z3Context() {
   return inst;
 }
 
+std::mutex& Z3ContextMutex() {
+  static std::mutex inst;
+  return inst;
+}
+
+static Theory& _Theory() {
+  static Theory inst = Theory::kBitVector;
+  return inst;
+}
+
+void SetTheory(Theory theory) {
+  _Theory() = theory;
+}
+
+Theory GetTheory() {
+  return _Theory();
+}
+
+static std::atomic<int>& _SimplifyLevel() {
+  static std::atomic<int> inst{SIMPLIFY_LEVEL};
+  return inst;
+}
+
+void SetSimplifyLevel(int level) {
+  VERIFY((0 <= level) && (level <= 10))
+    << "simplify level " << level << " is out of range [0, 10]";
+  _SimplifyLevel() = level;
+}
+
+int GetSimplifyLevel() {
+  return _SimplifyLevel();
+}
+
+static ReduceMode& _ReduceMode() {
+  static ReduceMode inst = ReduceMode::kLinear;
+  return inst;
+}
+
+void SetReduceMode(ReduceMode mode) {
+  _ReduceMode() = mode;
+}
+
+ReduceMode GetReduceMode() {
+  return _ReduceMode();
+}
+
+SymbolTable* SymbolTable::Get() {
+  static SymbolTable inst;
+  return &inst;
+}
+
+std::vector<SymbolTable::Block> SymbolTable::reserve(
+    const std::string &name, size_t size) {
+  static const size_t kMaxSymbols = size_t{1} << 30;
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<Block> &blocks = blocks_[name];
+  size_t reserved = blocks.empty() ? 0 :
+    blocks.back().start + blocks.back().size;
+  if (size > reserved) {
+    size_t n = size - reserved;
+    if (n > kMaxSymbols - next_) return {};
+    Block b{next_, reserved, n};
+    next_ += static_cast<int>(n);
+    blocks.push_back(b);
+    names_.emplace(b.base, std::make_pair(name, b));
+  }
+  return blocks;
+}
+
+std::string SymbolTable::name(symbol const& s) {
+  if (s.kind() != Z3_INT_SYMBOL) return s.str();
+  int id = s.to_int();
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = names_.upper_bound(id);
+  if (it == names_.begin()) return s.str();
+  --it;
+  Block const& b = it->second.second;
+  return it->second.first + "_" + std::to_string(b.start + (id - b.base));
+}
+
+SimplifyScope::SimplifyScope(int level) : prev_(GetSimplifyLevel()) {
+  if (level >= 0) SetSimplifyLevel(level);
+}
+
+SimplifyScope::~SimplifyScope() {
+  _SimplifyLevel() = prev_;
+}
+
+void InitContext(context &ctx) {
+  _InitContextDecl(ctx);
+}
+
+void ReleaseContext(context &ctx) {
+  _ReleaseContextDecl(ctx);
+}
+
 // ===== z3 data & cstr =====
 
 // z3_data::z3_data() : expr(_IntVal(0)) {}
@@ -34,34 +135,104 @@ z3_cstr::z3_cstr(expr val) : expr(val) {
   }
 }
 
+/*
+ * Simplification of constraints memoized by ast id, the entry
+ *  keeps the source alive, so that the id is not reused. Only
+ *  the global context is memoized.
+ **/
+static std::unordered_map<unsigned, std::pair<expr, expr> >&
+_SimplifyMemoTable() {
+  static std::unordered_map<unsigned, std::pair<expr, expr> > memo;
+  return memo;
+}
+
+void ClearSimplifyMemo() {
+  std::unordered_map<unsigned, std::pair<expr, expr> >().swap(
+      _SimplifyMemoTable());
+}
+
+static expr _SimplifyMemo(const expr &e) {
+  static const size_t kMaxEntries = 1 << 20;
+  auto &memo = _SimplifyMemoTable();
+  if (&e.ctx() != &C) return e.simplify();
+  auto it = memo.find(e.id());
+  if (it != memo.end()) return it->second.second;
+  if (memo.size() >= kMaxEntries) memo.clear();
+  expr res = e.simplify();
+  memo.emplace(e.id(), std::make_pair(e, res));
+  return res;
+}
+
 z3_cstr operator&&(const z3_cstr &a, const z3_cstr &b) {
   if (a.is_true()) return b;
   else if (b.is_true()) return a;
-#if SIMPLIFY_LEVEL >= 6
-  const expr &a_sim = a.simplify();
-  const expr &b_sim = b.simplify();
-  if (a_sim.is_true()) return b;
-  else if (b_sim.is_true()) return a;
-  else if (a_sim.is_false() || b_sim.is_false()) 
-    return _BoolVal(false);
-#endif
+  if (GetSimplifyLevel() >= 6) {
+    const expr &a_sim = _SimplifyMemo(a);
+    const expr &b_sim = _SimplifyMemo(b);
+    if (a_sim.is_true()) return b;
+    else if (b_sim.is_true()) return a;
+    else if (a_sim.is_false() || b_sim.is_false()) 
+      return _BoolVal(false);
+  }
   return z3::operator&&(a, b);
 }
 
 z3_cstr operator||(const z3_cstr &a, const z3_cstr &b) {
   if (a.is_false()) return b;
   else if (b.is_false()) return a;
-#if SIMPLIFY_LEVEL >= 6
-  const expr &a_sim = a.simplify();
-  const expr &b_sim = b.simplify();
-  if (a_sim.is_false()) return b;
-  else if (b_sim.is_false()) return a;
-  else if (a_sim.is_true() || b_sim.is_true())
-    return _BoolVal(true);
-#endif
+  if (GetSimplifyLevel() >= 6) {
+    const expr &a_sim = _SimplifyMemo(a);
+    const expr &b_sim = _SimplifyMemo(b);
+    if (a_sim.is_false()) return b;
+    else if (b_sim.is_false()) return a;
+    else if (a_sim.is_true() || b_sim.is_true())
+      return _BoolVal(true);
+  }
   return z3::operator||(a, b);
 }
 
+// ===== z3 conjunction =====
+
+z3_conj& z3_conj::add(z3_cstr const& c) {
+  if (false_ || c.is_true()) return *this;
+  if (c.is_app() && c.decl().decl_kind() == Z3_OP_AND) {
+    for (unsigned i = 0; i < c.num_args(); ++i) add(z3_cstr(c.arg(i)));
+    return *this;
+  }
+  if (c.is_false() ||
+      (GetSimplifyLevel() >= 6 && _SimplifyMemo(c).is_false())) {
+    false_ = true;
+    conjuncts_.clear();
+    return *this;
+  }
+  if (GetSimplifyLevel() >= 6 && _SimplifyMemo(c).is_true()) return *this;
+  conjuncts_.push_back(c);
+  return *this;
+}
+
+z3_conj& z3_conj::add(z3_conj const& t) {
+  if (t.false_) {
+    false_ = true;
+    conjuncts_.clear();
+  } else if (!false_) {
+    conjuncts_.insert(conjuncts_.end(),
+        t.conjuncts_.begin(), t.conjuncts_.end());
+  }
+  return *this;
+}
+
+z3_cstr z3_conj::build() const {
+  if (false_) return _BoolVal(false);
+  expr_vector args(C);
+  std::unordered_set<unsigned> ids;
+  for (const expr &c : conjuncts_) {
+    if (ids.insert(c.id()).second) args.push_back(c);
+  }
+  if (args.empty()) return _BoolVal(true);
+  if (args.size() == 1) return args[0];
+  return mk_and(args);
+}
+
 // ===== z3_expr =====
 
 z3_expr::z3_expr(const std::string &name) : data(name) {}
@@ -87,11 +258,8 @@ z3_expr z3_expr::closed_interval(
 }
 
 z3_expr z3_expr::bit_range() const {
-#if SIMPLIFY_LEVEL <= 3
-  return func_bit_range(*this);
-#else
+  if (GetSimplifyLevel() <= 3) return func_bit_range(*this);
   return op_one_shl((*this - 1)) - 1;
-#endif
 }
 z3_expr z3_expr::get_bit() const {
   return func_get_bit(*this);
@@ -192,7 +360,8 @@ Shape Shape::from_string(const std::string& st) {
     while ((st[i+cnt] >= '0') && (st[i+cnt] <= '9')) {
       cnt++;
     }
-    VERIFY(st[i+cnt] == ',' || st[i+cnt] == ' ' || st[i+cnt] == ')');
+    VERIFY(st[i+cnt] == ',' || st[i+cnt] == ' ' ||
+           st[i+cnt] == ')' || st[i+cnt] == ']');
     if (cnt > 0) {
       re.emplace_back(std::stoi(st.substr(i, cnt)));
     }
@@ -203,36 +372,63 @@ Shape Shape::from_string(const std::string& st) {
 
 // ===== TypeRef =====
 
+TypeRef::TypeRef(
+    MakeKey, std::vector<z3_expr> &&data,
+    const z3_expr &prec,
+    const Shape &shp) :
+    prec(prec), shape(shp), data(std::move(data)) {
+  VERIFY_EQ(shp.Size(), this->data.size())
+    << "TypeRef initializing with non consistent "
+    << "shape & data size "
+    << shp.to_string() << "==" << shp.Size()
+    << " vs. " << this->data.size();
+}
+
+static std::vector<z3_expr> MakeSymbols(
+    const std::string &name, size_t size) {
+  std::vector<z3_expr> data;
+  data.reserve(size);
+  if (size == 0) return data;
+  auto blocks = SymbolTable::Get()->reserve(name, size);
+  if (blocks.empty()) {
+    // Integer symbols are used up, fall back to string names.
+    for (size_t i = 0; i < size; ++i) {
+      data.emplace_back(name + "_" + std::to_string(i));
+    }
+    return data;
+  }
+  sort s = _IntSort();
+  for (auto const& b : blocks) {
+    for (size_t i = 0; i < b.size && b.start + i < size; ++i) {
+      data.emplace_back(z3_data(_IntSym(C, b.base + int(i), s)));
+    }
+  }
+  return data;
+}
+
+// Build the type in place, without copy of the data.
 TypePtr TypeRef::Make(
     const std::string &name, 
     const Shape &shape) {
-  std::vector<z3_expr> data;
-  for (size_t i = 0; i < shape.Size(); ++i) {
-    data.emplace_back(name + "_" + std::to_string(i));
-  }
   return std::make_shared<TypeRef>(
-      TypeRef(data,
-        z3_expr(name + "_prec"),
-        shape));
+      MakeKey(), MakeSymbols(name, shape.Size()),
+      z3_expr(name + "_prec"), shape);
 }
 
 TypePtr TypeRef::Make(
     const std::string &name, 
     const Shape &shape,
     const z3_expr &prec) {
-  std::vector<z3_expr> data;
-  for (size_t i = 0; i < shape.Size(); ++i) {
-    data.emplace_back(name + "_" + std::to_string(i));
-  }
   return std::make_shared<TypeRef>(
-      TypeRef(data, prec, shape));
+      MakeKey(), MakeSymbols(name, shape.Size()), prec, shape);
 }
 
 TypePtr TypeRef::Make(
     const std::vector<z3_expr> &data,
     const z3_expr &prec,
     const Shape &shape) {
-  return std::make_shared<TypeRef>(TypeRef(data, prec, shape));
+  return std::make_shared<TypeRef>(
+      MakeKey(), std::vector<z3_expr>(data), prec, shape);
 }
 
 TypePtr TypeRef::copy(const std::string &name) const {
@@ -247,46 +443,73 @@ TypePtr TypeRef::copy(const std::string &name) const {
 }
 
 void TypeRef::set_data(size_t index, z3_expr const& v) {
-  assign_constraints_[index] = (data[index] == v);
-  VERIFY(operator_assertions_[index].cstr.is_true())
+  VERIFY((0 <= index) && (index < data.size()));
+  if (values_.empty()) {
+    values_.resize(data.size() + 1, z3_expr(true));
+    assigned_.resize(data.size() + 1, false);
+  }
+  VERIFY(!assigned_[index] || values_[index].cstr.is_true())
     << "TypeRef::set_data(): op constraints has been set";
-  operator_assertions_[index] = z3_expr(true) && v;
+  values_[index] = v;
+  assigned_[index] = true;
+  op_memo_.valid = assign_memo_.valid = false;
 }
 void TypeRef::set_prec(z3_expr const& v) {
-  assign_constraints_[data.size()] = (prec == v);
-  VERIFY(operator_assertions_[data.size()].cstr.is_true())
+  if (values_.empty()) {
+    values_.resize(data.size() + 1, z3_expr(true));
+    assigned_.resize(data.size() + 1, false);
+  }
+  VERIFY(!assigned_[data.size()] || values_[data.size()].cstr.is_true())
     << "TypeRef::set_prec(): prec constraints has been set";
-  operator_assertions_[data.size()] = z3_expr(true) && v;
+  values_[data.size()] = v;
+  assigned_[data.size()] = true;
+  op_memo_.valid = assign_memo_.valid = false;
+}
+
+z3_expr TypeRef::assign_constraint(size_t index) const {
+  if (assigned_.empty() || !assigned_[index]) return z3_expr(true);
+  z3_expr const& sym = index < data.size() ? data[index] : prec;
+  return sym == values_[index];
+}
+z3_expr TypeRef::operator_assertion(size_t index) const {
+  if (assigned_.empty() || !assigned_[index]) return z3_expr(true);
+  return z3_expr(true) && values_[index];
 }
 
 z3_expr TypeRef::data_constraints() {
+  if (data_memo_.valid) return data_memo_.value;
   // z3_expr cstr = prec.closed_interval(1, 32);
-  z3_expr cstr(true);
-  z3_expr r = prec.bit_range();
-  for (auto &d : data) {
-    cstr = cstr && d.closed_interval(-r, r);
+  z3_conj cstr;
+  for (size_t i = 0; i < data.size(); ++i) {
+    cstr.add(data_constraints(i));
   }
-  return cstr;
+  data_memo_.value = cstr.to_expr();
+  data_memo_.valid = true;
+  return data_memo_.value;
 }
 z3_expr TypeRef::data_constraints(size_t index) {
   VERIFY((0 <= index) && (index < data.size()));
-  z3_expr const& r = prec.bit_range();
+  z3_expr const& r = bit_range();
   return data[index].closed_interval(-r, r);
 }
 
 z3_expr TypeRef::op_constraints() {
-  z3_expr asrt = prec;
+  if (op_memo_.valid) return op_memo_.value;
+  z3_conj asrt;
+  asrt.add(prec);
   for (const z3_expr &d : data) {
-    asrt = asrt && d;
+    asrt.add(d);
   }
-  for (z3_expr const& a : operator_assertions_) {
-    asrt = asrt && a;
+  for (size_t i = 0; i < assigned_.size(); ++i) {
+    if (assigned_[i]) asrt.add(operator_assertion(i));
   }
-  return asrt;
+  op_memo_.value = asrt.to_expr();
+  op_memo_.valid = true;
+  return op_memo_.value;
 }
 z3_expr TypeRef::op_constraints(size_t index) {
   return prec && data[index] &&
-    operator_assertions_[index];
+    operator_assertion(index);
 }
 
 z3_expr TypeRef::prec_constraints() {
@@ -298,36 +521,71 @@ z3_expr TypeRef::prec_constraints() {
 }
 
 z3_expr TypeRef::assign_constraints() {
-  z3_expr cstr(true);
-  for (const auto& c : assign_constraints_) {
-    cstr = cstr && c;
+  if (assign_memo_.valid) return assign_memo_.value;
+  z3_conj cstr;
+  for (size_t i = 0; i < assigned_.size(); ++i) {
+    if (assigned_[i]) cstr.add(assign_constraint(i));
   }
-  return cstr;
+  assign_memo_.value = cstr.to_expr();
+  assign_memo_.valid = true;
+  return assign_memo_.value;
 }
 z3_expr TypeRef::assign_constraints(size_t index) {
   VERIFY((0 <= index) && (index < data.size()));
-  return assign_constraints_[index] &&
-    assign_constraints_[data.size()];
+  return assign_constraint(index) &&
+    assign_constraint(data.size());
+}
+
+z3_expr TypeRef::prec_assign_constraints() {
+  return assign_constraint(data.size());
+}
+
+z3_expr TypeRef::proven_prec() const {
+  size_t n = data.size();
+  if (assigned_.empty() || !assigned_[n]) return prec;
+  expr v = values_[n].data.simplify();
+  if (!v.is_numeral()) return prec;
+  return z3_expr(z3_data(v));
+}
+
+z3_expr const& TypeRef::assigned(size_t index) const {
+  VERIFY((0 <= index) && (index <= data.size()));
+  if (assigned_.empty() || !assigned_[index]) {
+    return index < data.size() ? data[index] : prec;
+  }
+  return values_[index];
+}
+
+z3_expr const& TypeRef::bit_range() {
+  if (!range_memo_.valid) {
+    range_memo_.value = prec.bit_range();
+    range_memo_.valid = true;
+  }
+  return range_memo_.value;
+}
+
+z3_expr TypeRef::range_constraints() {
+  return bit_range().closed_interval(0, Z3_INT32_MAX);
 }
 
 z3_expr TypeRef::collect_constraints(std::vector<TypePtr> trs) {
-  z3_expr cstr(true);
+  z3_conj cstr;
   for (const auto &tr : trs) {
-    cstr = cstr &&
-      tr->data_constraints() &&
-      tr->op_constraints() &&
-      tr->prec_constraints() &&
-      tr->assign_constraints();
+    cstr.add(tr->data_constraints())
+      .add(tr->op_constraints())
+      .add(tr->prec_constraints())
+      .add(tr->assign_constraints());
   }
-  return cstr;
+  return cstr.to_expr();
 }
 
 z3_expr TypeRef::deterministic() {
-  z3_expr dtmt = prec.deterministic();
+  z3_conj dtmt;
+  dtmt.add(prec.deterministic());
   for (auto &d : data) {
-    dtmt = dtmt && d.deterministic();
+    dtmt.add(d.deterministic());
   }
-  return dtmt;
+  return dtmt.to_expr();
 }
 
 }
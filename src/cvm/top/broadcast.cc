@@ -49,6 +49,47 @@ inline int32_t broadcast_i_index(const Shape& oshape, uint64_t o_index, const Sh
   return index;
 }
 
+using concrete_bin_op = std::function<int64_t(int64_t, int64_t, bool&)>;
+
+/*
+ * Concrete executor of broadcast binary operator, the inputs are
+ *  aligned to the trailing axes of output and the axes of size 1
+ *  are repeated, as numpy does. The fault flag of op is recorded
+ *  as what.
+ **/
+static Op::FConcrete BroadcastConcrete(
+    concrete_bin_op const& op, std::string const& what) {
+  return [op, what](NodeAttrs const& attrs,
+                    std::vector<ConcreteTensor> const& inputs,
+                    std::vector<ConcreteTensor>& outputs,
+                    ConcreteFaults& faults) {
+    ConcreteTensor const& a = inputs.at(0);
+    ConcreteTensor const& b = inputs.at(1);
+    ConcreteTensor& z = outputs.at(0);
+    int zdim = z.shape.size();
+    bool fault = false;
+    for (size_t i = 0; i < z.Size(); ++i) {
+      size_t o_i = i, a_i = 0, b_i = 0, a_size = 1, b_size = 1;
+      for (int j = zdim - 1; j >= 0; j--) {
+        size_t col = o_i % z.shape[j];
+        o_i /= z.shape[j];
+        int aj = j - (zdim - a.shape.size());
+        int bj = j - (zdim - b.shape.size());
+        if (aj >= 0) {
+          if (a.shape[aj] != 1) a_i += col * a_size;
+          a_size *= a.shape[aj];
+        }
+        if (bj >= 0) {
+          if (b.shape[bj] != 1) b_i += col * b_size;
+          b_size *= b.shape[bj];
+        }
+      }
+      z.data[i] = op(a.data[a_i], b.data[b_i], fault);
+    }
+    faults.check(fault, what);
+  };
+}
+
 static void BroadcastAddForward(
     NodeAttrs const& attrs,
     std::vector<TypePtr>& inputs,
@@ -126,6 +167,8 @@ Z3_REGISTER_OP(broadcast_add)
   .set_num_inputs(2)
   .set_num_outputs(1)
   .set_forward(BroadcastAddForward)
+  .set_concrete(
+      BroadcastConcrete(concrete::add, "int64 overflow of add"))
   .set_infer_shape(BroadcastAddInferShape)
   .set_infer_precision(BroadcastAddInferPrecision)
   .set_generator(prove_gen(op_add, prec_add));
@@ -215,6 +258,8 @@ Z3_REGISTER_OP(broadcast_sub)
   .set_num_inputs(2)
   .set_num_outputs(1)
   .set_forward(BroadcastSubForward)
+  .set_concrete(
+      BroadcastConcrete(concrete::sub, "int64 overflow of sub"))
   .set_infer_shape(BroadcastSubInferShape)
   .set_infer_precision(BroadcastSubInferPrecision)
   .set_generator(prove_gen(op_sub, prec_sub));
@@ -307,6 +352,8 @@ Z3_REGISTER_OP(broadcast_mul)
   .set_num_inputs(2)
   .set_num_outputs(1)
   .set_forward(BroadcastMulForward)
+  .set_concrete(
+      BroadcastConcrete(concrete::mul, "int64 overflow of mul"))
   .set_infer_shape(BroadcastMulInferShape)
   .set_infer_precision(BroadcastMulInferPrecision)
   .set_generator(prove_gen(op_mul, prec_mul));
@@ -394,6 +441,8 @@ Z3_REGISTER_OP(broadcast_div)
   .set_num_inputs(2)
   .set_num_outputs(1)
   .set_forward(BroadcastDivForward)
+  .set_concrete(
+      BroadcastConcrete(concrete::div, "int64 overflow of div"))
   .set_infer_shape(BroadcastDivInferShape)
   .set_infer_precision(BroadcastDivInferPrecision)
   .set_generator(prove_gen(op_div, prec_div));
@@ -486,6 +535,9 @@ Z3_REGISTER_OP(broadcast_max)
   .set_num_inputs(2)
   .set_num_outputs(1)
   .set_forward(BroadcastMaxForward)
+  .set_concrete(BroadcastConcrete(
+        [](int64_t a, int64_t b, bool&) { return concrete::max(a, b); },
+        ""))
   .set_infer_shape(BroadcastMaxInferShape)
   .set_infer_precision(BroadcastMaxInferPrecision)
   .set_generator(prove_gen(op_max, prec_max));
@@ -49,6 +49,53 @@ inline func_pg prove_gen(
 #define BIN_PREC_FUNC(name, a, b) \
   BIN_LAMBDA_DECL_(prec, name, a, b)
 
+/*
+ * Accumulator of the sum in the shape of GetReduceMode. Linear
+ *  mode adds the terms one by one into the initial value, tree
+ *  mode merges the partial sums of the same number of terms like
+ *  a binary counter, which builds the balanced tree online.
+ **/
+class SumReducer {
+ public:
+  SumReducer() : mode_(type::GetReduceMode()) {
+    if (mode_ == type::ReduceMode::kLinear) parts_.emplace_back(0, 0);
+  }
+  explicit SumReducer(type::z3_expr const& init)
+    : mode_(type::GetReduceMode()) {
+    parts_.emplace_back(init, 1);
+  }
+
+  inline SumReducer& add(type::z3_expr const& v) {
+    if (mode_ == type::ReduceMode::kLinear) {
+      parts_[0].first = parts_[0].first + v;
+      return *this;
+    }
+    parts_.emplace_back(v, 1);
+    size_t n = parts_.size();
+    while (n >= 2 && parts_[n-1].second == parts_[n-2].second) {
+      parts_[n-2].first = parts_[n-2].first + parts_[n-1].first;
+      parts_[n-2].second += parts_[n-1].second;
+      parts_.pop_back();
+      --n;
+    }
+    return *this;
+  }
+
+  inline type::z3_expr result() const {
+    if (parts_.empty()) return type::z3_expr(0);
+    type::z3_expr sum = parts_.back().first;
+    for (size_t i = parts_.size() - 1; i > 0; --i) {
+      sum = parts_[i-1].first + sum;
+    }
+    return sum;
+  }
+
+ private:
+  type::ReduceMode mode_;
+  // Partial sums and their number of terms.
+  std::vector<std::pair<type::z3_expr, size_t> > parts_;
+};
+
 inline std::vector<type::z3_expr>
 null_generator() {
   return {};
@@ -1,5 +1,6 @@
 #include "cvm/op.h"
 #include "cvm/node.h"
+#include "cvm/discharge.h"
 #include "common.h"
 
 namespace z3 {
@@ -57,7 +58,7 @@ void groupwise_conv2d(
       for(int32_t oh = 0; oh < o_h; ++oh){
         for(int32_t ow = 0; ow < o_w; ++ow){
           int32_t oi = n * out_channels * o_h * o_w + oc * o_h * o_w + oh * o_w + ow;
-          z3_expr sum = 0;
+          SumReducer reducer;
           int32_t ic = oc / ochannels_per_group * ichannels_per_group;
           for(int32_t tic = 0; tic < ichannels_per_group; ++tic){
             for(int32_t fh = 0; fh < filter_h; ++fh){
@@ -68,13 +69,14 @@ void groupwise_conv2d(
                   continue;
                 int32_t xi = n * in_channels * x_h * x_w + (ic+tic) * x_h * x_w + th * x_w + filter_w;
                 int32_t wi = oc * filter_c * filter_h * filter_w + tic * filter_h * filter_w + fh * filter_w + fw;
-                sum = sum + x->at(xi) * w->at(wi);
+                reducer.add(x->at(xi) * w->at(wi));
                 nas[0].at(oi)
                   .add_input(x, xi)
                   .add_input(w, wi);
               }
             }
           }
+          z3_expr sum = reducer.result();
           if (use_bias){
             y->set_data(oi, sum + b->at(oc));
             nas[0].at(oi)
@@ -149,11 +151,11 @@ void matrix_mul(std::vector<z3_expr>& a, const std::vector<int>& a_index, TypePt
 {
      for(int i = 0; i < M; i++){
         for(int j = 0; j < N; j++){
-         z3_expr y_sum = 0;
+         SumReducer reducer;
         int yid = i * N + j + base_index; 
           for(int k = 0; k < K; k++){
              auto aV = a.at(i * K + k);
-               y_sum = y_sum + aV * b.at(k * N + j); 
+               reducer.add(aV * b.at(k * N + j));
                 if (a_index.at(i * K + k) != -1){
                   nas[0].at(yid)
                     .add_input(w, a_index.at(i * K + k));
@@ -164,6 +166,7 @@ void matrix_mul(std::vector<z3_expr>& a, const std::vector<int>& a_index, TypePt
                     .add_input(x, b_index.at(k * N + j));
                 }
              }
+         z3_expr y_sum = reducer.result();
          if(use_bias){
             y_sum = y_sum + bias->at(i);
             nas[0].at(yid)
@@ -398,13 +401,99 @@ static void Conv2dInferPrecision(
   oprecs.at(0) = oprec;
 }
 
+/*
+ * Compositional rule of conv2d, see `mac_discharge`. Every
+ *  output sums at most K = C/groups * KH * KW products of data
+ *  and weight, the zero padding terms contribute nothing, and
+ *  the output precision px + pw + GetBit(K) bounds the sum in
+ *  the same way as dense:
+ *
+ *    K * R(px) * R(pw) < 2^(px+pw+GetBit(K)-2) <= R(py),
+ *
+ *  so every output closes by chaining mac_lemma, cases of
+ *  precisions whose output precision exceeds 32 are vacuous.
+ **/
+static std::vector<bool> Conv2dCompositional(
+    NodeAttrs const& attrs,
+    std::vector<TypePtr> const& inputs,
+    std::vector<TypePtr> const& outputs,
+    z3_expr const& background) {
+  TypePtr bias = attrs.dict.at("use_bias") == "true" ?
+    inputs.at(2) : nullptr;
+  return mac_discharge(inputs.at(0), inputs.at(1), bias,
+                       outputs.at(0), background);
+}
+
+/*
+ * Direct convolution of NCHW data and OIHW weight, every group
+ *  of out channels reads its own group of in channels.
+ **/
+static void Conv2dConcrete(
+    NodeAttrs const& attrs,
+    std::vector<ConcreteTensor> const& inputs,
+    std::vector<ConcreteTensor>& outputs,
+    ConcreteFaults& faults) {
+  ConcreteTensor const& x = inputs.at(0);
+  ConcreteTensor const& w = inputs.at(1);
+  ConcreteTensor& y = outputs.at(0);
+  bool use_bias;
+  std::istringstream(attrs.dict.at("use_bias")) >> std::boolalpha >> use_bias;
+  Shape padding = Shape::from_string(attrs.dict.at("padding"));
+  Shape strides = Shape::from_string(attrs.dict.at("strides"));
+  Shape dilation = Shape::from_string(attrs.dict.at("dilation"));
+  int groups = std::stoi(attrs.dict.at("groups"));
+
+  int n_batch = x.shape[0], in_channels = x.shape[1];
+  int x_h = x.shape[2], x_w = x.shape[3];
+  int out_channels = w.shape[0], filter_c = w.shape[1];
+  int filter_h = w.shape[2], filter_w = w.shape[3];
+  int o_h = y.shape[2], o_w = y.shape[3];
+  int ochannels_per_group = out_channels / groups;
+
+  bool overflow = false;
+  for (int n = 0; n < n_batch; ++n) {
+    for (int oc = 0; oc < out_channels; ++oc) {
+      int ic_start = oc / ochannels_per_group * filter_c;
+      for (int oh = 0; oh < o_h; ++oh) {
+        for (int ow = 0; ow < o_w; ++ow) {
+          int64_t sum = 0;
+          for (int ic = 0; ic < filter_c; ++ic) {
+            const int64_t *xc = x.data.data() +
+              (n * in_channels + ic_start + ic) * x_h * x_w;
+            const int64_t *wc = w.data.data() +
+              (oc * filter_c + ic) * filter_h * filter_w;
+            for (int fh = 0; fh < filter_h; ++fh) {
+              int th = oh * strides[0] + fh * dilation[0] - padding[0];
+              if (th < 0 || th >= x_h) continue;
+              for (int fw = 0; fw < filter_w; ++fw) {
+                int tw = ow * strides[1] + fw * dilation[1] - padding[1];
+                if (tw < 0 || tw >= x_w) continue;
+                sum = concrete::add(sum, concrete::mul(
+                      xc[th * x_w + tw], wc[fh * filter_w + fw], overflow),
+                    overflow);
+              }
+            }
+          }
+          if (use_bias) {
+            sum = concrete::add(sum, inputs.at(2).data[oc], overflow);
+          }
+          y.data[((n * out_channels + oc) * o_h + oh) * o_w + ow] = sum;
+        }
+      }
+    }
+  }
+  faults.check(overflow, "int64 overflow of multiply-accumulate");
+}
+
 Z3_REGISTER_OP(conv2d)
   .set_num_inputs(UseBiasNumInputsConv2d)
   .set_num_outputs(1)
   .set_attr_default(Conv2dAttrDefault)
   .set_forward(Conv2dForward)
+  .set_concrete(Conv2dConcrete)
   .set_infer_shape(Conv2dInferShape)
   .set_infer_precision(Conv2dInferPrecision)
+  .set_compositional(Conv2dCompositional)
   .set_generator(null_generator);
 
 
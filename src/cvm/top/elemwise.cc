@@ -52,12 +52,29 @@ static void ElemwiseAddInferPrecision(
   oprecs.at(0) = max_prec + 1;
 }
   
+static void ElemwiseAddConcrete(
+    NodeAttrs const& attrs,
+    std::vector<ConcreteTensor> const& inputs,
+    std::vector<ConcreteTensor>& outputs,
+    ConcreteFaults& faults) {
+  const int64_t *a = inputs.at(0).data.data();
+  const int64_t *b = inputs.at(1).data.data();
+  int64_t *y = outputs[0].data.data();
+  size_t size = outputs[0].Size();
+  bool overflow = false;
+  for (size_t i = 0; i < size; ++i) {
+    y[i] = concrete::add(a[i], b[i], overflow);
+  }
+  faults.check(overflow, "int64 overflow of add");
+}
+
 Z3_REGISTER_OP(elemwise_add)
   .set_num_inputs(2)
   .set_num_outputs(1)
   .set_infer_shape(ElemwiseAddInferShape)
   .set_infer_precision(ElemwiseAddInferPrecision)
   .set_forward(ElemwiseAddForward)
+  .set_concrete(ElemwiseAddConcrete)
   .set_generator(prove_gen(op_add, prec_add));
 
 BIN_OP_FUNC(op_sub, a, b) {
@@ -103,12 +120,29 @@ static void ElemwiseSubInferPrecision(
   oprecs[0] = max_prec + 1;
 }
   
+static void ElemwiseSubConcrete(
+    NodeAttrs const& attrs,
+    std::vector<ConcreteTensor> const& inputs,
+    std::vector<ConcreteTensor>& outputs,
+    ConcreteFaults& faults) {
+  const int64_t *a = inputs.at(0).data.data();
+  const int64_t *b = inputs.at(1).data.data();
+  int64_t *y = outputs[0].data.data();
+  size_t size = outputs[0].Size();
+  bool overflow = false;
+  for (size_t i = 0; i < size; ++i) {
+    y[i] = concrete::sub(a[i], b[i], overflow);
+  }
+  faults.check(overflow, "int64 overflow of sub");
+}
+
 Z3_REGISTER_OP(elemwise_sub)
   .set_num_inputs(2)
   .set_num_outputs(1)
   .set_infer_shape(ElemwiseSubInferShape)
   .set_infer_precision(ElemwiseSubInferPrecision)
   .set_forward(ElemwiseSubForward)
+  .set_concrete(ElemwiseSubConcrete)
   .set_generator(prove_gen(op_sub, prec_sub));
 
 static void ClipAttrDefault(NodeAttrs& attrs) {
@@ -190,6 +224,21 @@ std::vector<z3_expr> _clip_prove() {
   };
 }
 
+static void ClipConcrete(
+    NodeAttrs const& attrs,
+    std::vector<ConcreteTensor> const& inputs,
+    std::vector<ConcreteTensor>& outputs,
+    ConcreteFaults& faults) {
+  int64_t a_min = std::atoi(attrs.dict.at("a_min").c_str());
+  int64_t a_max = std::atoi(attrs.dict.at("a_max").c_str());
+  const int64_t *x = inputs.at(0).data.data();
+  int64_t *y = outputs[0].data.data();
+  size_t size = outputs[0].Size();
+  for (size_t i = 0; i < size; ++i) {
+    y[i] = concrete::clip(x[i], a_min, a_max);
+  }
+}
+
 Z3_REGISTER_OP(clip)
   .set_num_inputs(1)
   .set_num_outputs(1)
@@ -197,6 +246,7 @@ Z3_REGISTER_OP(clip)
   .set_infer_shape(ClipInferShape)
   .set_infer_precision(ClipInferPrecision)
   .set_forward(ClipForward)
+  .set_concrete(ClipConcrete)
   .set_generator(_clip_prove);
 
 std::vector<z3_expr> _cvm_clip_prove() {
@@ -276,11 +326,27 @@ static void CVMClipForward(
   }
 }
 
+static void CVMClipConcrete(
+    NodeAttrs const& attrs,
+    std::vector<ConcreteTensor> const& inputs,
+    std::vector<ConcreteTensor>& outputs,
+    ConcreteFaults& faults) {
+  int precision = std::stoi(attrs.dict.at("precision"));
+  int64_t a_max = concrete::prec_range(precision);
+  const int64_t *x = inputs.at(0).data.data();
+  int64_t *y = outputs[0].data.data();
+  size_t size = outputs[0].Size();
+  for (size_t i = 0; i < size; ++i) {
+    y[i] = concrete::clip(x[i], -a_max, a_max);
+  }
+}
+
 Z3_REGISTER_OP(cvm_clip)
   .set_num_inputs(1)
   .set_num_outputs(1)
   .set_attr_default(CVMClipAttrDefault)
   .set_forward(CVMClipForward)
+  .set_concrete(CVMClipConcrete)
   .set_infer_shape(CVMClipInferShape)
   .set_infer_precision(CVMClipInferPrecision)
   .set_generator(_cvm_clip_prove);
@@ -386,11 +452,34 @@ static void CVMRightShiftForward(
   }
 }
 
+static void CVMRightShiftConcrete(
+    NodeAttrs const& attrs,
+    std::vector<ConcreteTensor> const& inputs,
+    std::vector<ConcreteTensor>& outputs,
+    ConcreteFaults& faults) {
+  int precision = std::stoi(attrs.dict.at("precision"));
+  int b = std::stoi(attrs.dict.at("shift_bit"));
+  int64_t a_max = concrete::prec_range(precision);
+  const int64_t *x = inputs.at(0).data.data();
+  int64_t *y = outputs[0].data.data();
+  size_t size = outputs[0].Size();
+  // Rounded to nearest as ((x >> (b - 1)) + 1) >> 1.
+  bool overflow = false, invalid = false;
+  for (size_t i = 0; i < size; ++i) {
+    int64_t v = b == 1 ? x[i] : concrete::shr(x[i], b - 1, invalid);
+    v = concrete::shr(concrete::add(v, 1, overflow), 1, invalid);
+    y[i] = concrete::clip(v, -a_max, a_max);
+  }
+  faults.check(overflow, "int64 overflow of add");
+  faults.check(invalid, "shift bit out of [0, 31]");
+}
+
 Z3_REGISTER_OP(cvm_right_shift)
   .set_num_inputs(1)
   .set_num_outputs(1)
   .set_attr_default(CVMRightShiftAttrDefault)
   .set_forward(CVMRightShiftForward)
+  .set_concrete(CVMRightShiftConcrete)
   .set_infer_shape(CVMRightShiftInferShape)
   .set_infer_precision(CVMRightShiftInferPrecision)
   .set_generator(_cvm_right_shift_prove);
@@ -478,11 +567,30 @@ static void CVMLeftShiftForward(
   }
 }
 
+static void CVMLeftShiftConcrete(
+    NodeAttrs const& attrs,
+    std::vector<ConcreteTensor> const& inputs,
+    std::vector<ConcreteTensor>& outputs,
+    ConcreteFaults& faults) {
+  int precision = std::stoi(attrs.dict.at("precision"));
+  int b = std::stoi(attrs.dict.at("shift_bit"));
+  int64_t a_max = concrete::prec_range(precision);
+  const int64_t *x = inputs.at(0).data.data();
+  int64_t *y = outputs[0].data.data();
+  size_t size = outputs[0].Size();
+  bool invalid = false;
+  for (size_t i = 0; i < size; ++i) {
+    y[i] = concrete::clip(concrete::shl(x[i], b, invalid), -a_max, a_max);
+  }
+  faults.check(invalid, "left shift out of int32 or [0, 31] bits");
+}
+
 Z3_REGISTER_OP(cvm_left_shift)
   .set_num_inputs(1)
   .set_num_outputs(1)
   .set_attr_default(CVMLeftShiftAttrDefault)
   .set_forward(CVMLeftShiftForward)
+  .set_concrete(CVMLeftShiftConcrete)
   .set_infer_shape(CVMLeftShiftInferShape)
   .set_infer_precision(CVMLeftShiftInferPrecision)
   .set_generator(_cvm_left_shift_prove);
@@ -521,10 +629,26 @@ static void AbsInferPrecision(
   oprecs.at(0)  = iprecs.at(0); 
 }
 
+static void AbsConcrete(
+    NodeAttrs const& attrs,
+    std::vector<ConcreteTensor> const& inputs,
+    std::vector<ConcreteTensor>& outputs,
+    ConcreteFaults& faults) {
+  const int64_t *x = inputs.at(0).data.data();
+  int64_t *y = outputs[0].data.data();
+  size_t size = outputs[0].Size();
+  bool overflow = false;
+  for (size_t i = 0; i < size; ++i) {
+    y[i] = concrete::abs(x[i], overflow);
+  }
+  faults.check(overflow, "int64 overflow of abs");
+}
+
 Z3_REGISTER_OP(abs)
   .set_num_inputs(1)
   .set_num_outputs(1)
   .set_forward(AbsForward)
+  .set_concrete(AbsConcrete)
   .set_infer_shape(AbsInferShape)
   .set_infer_precision(AbsInferPrecision);
 
@@ -563,10 +687,26 @@ static void NegativeInferPrecision(
   oprecs.at(0)  = iprecs.at(0); 
 }
 
+static void NegativeConcrete(
+    NodeAttrs const& attrs,
+    std::vector<ConcreteTensor> const& inputs,
+    std::vector<ConcreteTensor>& outputs,
+    ConcreteFaults& faults) {
+  const int64_t *x = inputs.at(0).data.data();
+  int64_t *y = outputs[0].data.data();
+  size_t size = outputs[0].Size();
+  bool overflow = false;
+  for (size_t i = 0; i < size; ++i) {
+    y[i] = concrete::neg(x[i], overflow);
+  }
+  faults.check(overflow, "int64 overflow of neg");
+}
+
 Z3_REGISTER_OP(negative)
   .set_num_inputs(1)
   .set_num_outputs(1)
   .set_forward(NegativeForward)
+  .set_concrete(NegativeConcrete)
   .set_infer_shape(NegativeInferShape)
   .set_infer_precision(NegativeInferPrecision);
 
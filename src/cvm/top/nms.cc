@@ -128,6 +128,11 @@ static void NonMaxSuppressionInferPrecision(
 
 }
 
+/*
+ * No concrete executor: the forward above is a stub and the
+ *  generator emits no obligation, so there is neither symbolic
+ *  output to compare with nor counterexample to replay.
+ **/
 Z3_REGISTER_OP(non_max_suppression)
   .set_num_inputs(2)
   .set_num_outputs(1)
@@ -191,11 +196,43 @@ static void GetValidCountsInferPrecision(
 
 }
 
+/*
+ * Boxes of score above threshold are moved to the front in order,
+ *  and the rest rows are filled with -1, as get_valid_count of
+ *  CVM runtime.
+ **/
+static void GetValidCountsConcrete(
+    NodeAttrs const& attrs,
+    std::vector<ConcreteTensor> const& inputs,
+    std::vector<ConcreteTensor>& outputs,
+    ConcreteFaults& faults) {
+  ConcreteTensor const& x = inputs.at(0);
+  ConcreteTensor& valid_count = outputs.at(0);
+  ConcreteTensor& y = outputs.at(1);
+  int64_t score_threshold = std::stoi(attrs.dict.at("score_threshold"));
+  size_t batchs = x.shape[0], n = x.shape[1], k = x.shape[2];
+  for (size_t b = 0; b < batchs; ++b) {
+    int64_t const* input = x.data.data() + b * n * k;
+    int64_t *output = y.data.data() + b * n * k;
+    size_t y_index = 0;
+    for (size_t j = 0; j < n; ++j) {
+      int64_t const* row = input + j * k;
+      if (row[1] > score_threshold) {
+        std::copy(row, row + k, output + y_index * k);
+        y_index++;
+      }
+    }
+    valid_count.data[b] = y_index;
+    std::fill(output + y_index * k, output + n * k, -1);
+  }
+}
+
 Z3_REGISTER_OP(get_valid_counts)
   .set_num_inputs(1)
   .set_num_outputs(2)
   .set_attr_default(GetValidCountsAttrDefault)
   .set_forward(GetValidCountsForward)
+  .set_concrete(GetValidCountsConcrete)
   .set_infer_shape(GetValidCountsInferShape)
   .set_infer_precision(GetValidCountsInferPrecision)
   .set_generator(null_generator);
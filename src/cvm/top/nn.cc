@@ -1,5 +1,6 @@
 #include "cvm/op.h"
 #include "cvm/node.h"
+#include "cvm/discharge.h"
 #include "common.h"
 
 namespace z3 {
@@ -34,7 +35,7 @@ void DenseForward(
     int y_offset = di * oshape[1];
     int x_offset = di * xshp[1];
     for (int oi = 0; oi < oshape[1]; ++oi) {
-      z3_expr sum = 0;
+      SumReducer reducer;
       int w_offset = oi * wshp[1];
       for (int xi = 0; xi < xshp[1]; ++xi) {
         z3_expr tmp = inputs.at(0)->at(x_offset + xi) * 
@@ -42,8 +43,9 @@ void DenseForward(
         nas[0].at(y_offset + oi)
           .add_input(inputs.at(0), x_offset + xi)
           .add_input(inputs.at(1), w_offset + xi);
-        sum = sum + tmp;
+        reducer.add(tmp);
       }
+      z3_expr sum = reducer.result();
 
       if (attrs.dict.at("use_bias") == "true") {
         sum = sum + inputs.at(2)->at(oi);
@@ -73,6 +75,29 @@ void DenseInferPrecision(
     .add_extra_constraint(iprecs[1] <= 8);
 }
 
+/*
+ * Compositional rule of dense, see `mac_discharge`. With input
+ *  precisions px, pw <= 8 and K inputs, the output precision
+ *  py = px + pw + GetBit(K) bounds the sum of K products,
+ *
+ *    K * R(px) * R(pw) < 2^GetBit(K) * 2^(px-1) * 2^(pw-1)
+ *                      = 2^(py-2) <= R(py),
+ *
+ *  and with bias, py = max(py', pb) + 1 covers the sum of two
+ *  terms bounded by R(py') and R(pb). So every output closes by
+ *  chaining mac_lemma instead of one K-term nonlinear query.
+ **/
+static std::vector<bool> DenseCompositional(
+    NodeAttrs const& attrs,
+    std::vector<TypePtr> const& inputs,
+    std::vector<TypePtr> const& outputs,
+    z3_expr const& background) {
+  TypePtr bias = attrs.dict.at("use_bias") == "true" ?
+    inputs.at(2) : nullptr;
+  return mac_discharge(inputs.at(0), inputs.at(1), bias,
+                       outputs.at(0), background);
+}
+
 void DenseInferShape(
     NodeAttrs const& attrs,
     std::vector<Shape> &ishpes,
@@ -96,12 +121,40 @@ void DenseInferShape(
   oshpes[0] = {batch, units};
 }
 
+static void DenseConcrete(
+    NodeAttrs const& attrs,
+    std::vector<ConcreteTensor> const& inputs,
+    std::vector<ConcreteTensor>& outputs,
+    ConcreteFaults& faults) {
+  Shape const& xshp = inputs.at(0).shape;
+  Shape const& oshape = outputs.at(0).shape;
+  bool use_bias = attrs.dict.at("use_bias") == "true";
+  int64_t *y = outputs[0].data.data();
+  bool overflow = false;
+  for (int di = 0; di < oshape[0]; ++di) {
+    const int64_t *x = inputs.at(0).data.data() + di * xshp[1];
+    for (int oi = 0; oi < oshape[1]; ++oi) {
+      const int64_t *w = inputs.at(1).data.data() + oi * xshp[1];
+      int64_t sum = 0;
+      for (int xi = 0; xi < xshp[1]; ++xi) {
+        sum = concrete::add(sum, concrete::mul(x[xi], w[xi], overflow),
+                            overflow);
+      }
+      if (use_bias) sum = concrete::add(sum, inputs.at(2).data[oi], overflow);
+      y[di * oshape[1] + oi] = sum;
+    }
+  }
+  faults.check(overflow, "int64 overflow of multiply-accumulate");
+}
+
 Z3_REGISTER_OP(dense)
   .set_num_inputs(UseBiasNumInputs)
   .set_attr_default(DenseParamDefault)
   .set_infer_shape(DenseInferShape)
   .set_infer_precision(DenseInferPrecision)
   .set_forward(DenseForward)
+  .set_concrete(DenseConcrete)
+  .set_compositional(DenseCompositional)
   .set_num_outputs(1);
 
 void ReluForward(
@@ -122,12 +175,26 @@ void ReluForward(
   }
 }
 
+static void ReluConcrete(
+    NodeAttrs const& attrs,
+    std::vector<ConcreteTensor> const& inputs,
+    std::vector<ConcreteTensor>& outputs,
+    ConcreteFaults& faults) {
+  const int64_t *x = inputs.at(0).data.data();
+  int64_t *y = outputs[0].data.data();
+  size_t size = outputs[0].Size();
+  for (size_t i = 0; i < size; ++i) {
+    y[i] = concrete::max(x[i], 0);
+  }
+}
+
 Z3_REGISTER_OP(relu)
   .set_num_inputs(1)
   .set_num_outputs(1)
   .set_infer_shape(SameShape)
   .set_infer_precision(SamePrecision)
-  .set_forward(ReluForward);
+  .set_forward(ReluForward)
+  .set_concrete(ReluConcrete);
 
 }
 }
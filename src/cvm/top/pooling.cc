@@ -203,11 +203,51 @@ static void MaxPool2dInferPrecision(
   oprecs.at(0) = iprecs.at(0);
 }
 
+static void MaxPool2dConcrete(
+    NodeAttrs const& attrs,
+    std::vector<ConcreteTensor> const& inputs,
+    std::vector<ConcreteTensor>& outputs,
+    ConcreteFaults& faults) {
+  ConcreteTensor const& x = inputs.at(0);
+  ConcreteTensor& y = outputs.at(0);
+  Shape pool_size = Shape::from_string(attrs.dict.at("pool_size"));
+  Shape strides = Shape::from_string(attrs.dict.at("strides"));
+  Shape padding = Shape::from_string(attrs.dict.at("padding"));
+  int pad_h = padding.at(0);
+  int pad_w = padding.size() == 2 ? padding[1] : padding[0];
+
+  int n_batch = x.shape[0], channels = x.shape[1];
+  int x_h = x.shape[2], x_w = x.shape[3];
+  int o_h = y.shape[2], o_w = y.shape[3];
+  // The window out of input keeps the minimum of int32.
+  const int64_t minV = std::numeric_limits<int32_t>::min();
+  for (int nc = 0; nc < n_batch * channels; ++nc) {
+    const int64_t *xc = x.data.data() + nc * x_h * x_w;
+    int64_t *yc = y.data.data() + nc * o_h * o_w;
+    for (int p = 0; p < o_h; ++p) {
+      for (int q = 0; q < o_w; ++q) {
+        int64_t y_max = minV;
+        for (int r = 0; r < pool_size[0]; ++r) {
+          int tp = p * strides[0] + r - pad_h;
+          if (tp < 0 || tp >= x_h) continue;
+          for (int s = 0; s < pool_size[1]; ++s) {
+            int tq = q * strides[1] + s - pad_w;
+            if (tq < 0 || tq >= x_w) continue;
+            y_max = concrete::max(y_max, xc[tp * x_w + tq]);
+          }
+        }
+        yc[p * o_w + q] = y_max;
+      }
+    }
+  }
+}
+
 Z3_REGISTER_OP(max_pool2d)
   .set_num_inputs(kVarg)
   .set_num_outputs(1)
   .set_attr_default(MaxPool2dAttrDefault)
   .set_forward(MaxPool2dForward)
+  .set_concrete(MaxPool2dConcrete)
   .set_infer_shape(MaxPool2dInferShape)
   .set_infer_precision(MaxPool2dInferPrecision)
   .set_generator(prove_gen(op_max, prec_max));
@@ -61,11 +61,6 @@ static void SumForward(
   std::istringstream(st_exclude) >> std::boolalpha >> exclude;
   
 
-  reduce_func f = [](z3_expr& tmp, z3_expr value)->void {
-    tmp = tmp + value;
-  };
-
-
   std::vector<int64_t> realAxis = GetRealAxis(axis, exclude, x->ndim());
 
   if(exclude && realAxis.size() == 0){
@@ -76,13 +71,13 @@ static void SumForward(
          .add_output(y, i);
      }
   } else if (realAxis.size() == 0) {
-    z3_expr tmp = 0;
+    SumReducer reducer;
     for(uint64_t i = 0; i < x->Size(); i++){
-      f(tmp, x->at(i));
+      reducer.add(x->at(i));
       nas[0].at(0).add_input(x, i);
     }
     nas[0].at(0).add_output(y, 0);
-    y->set_data(0, tmp);
+    y->set_data(0, reducer.result());
   } else {
     std::vector<bool> flag(x->ndim(), false);
     for(uint32_t i = 0; i < realAxis.size(); i++){
@@ -125,7 +120,7 @@ static void SumForward(
         while(xj >= 0 && flag[xj--]);
         in_i += col * every_xdim_size[xj+1];
       }
-      auto tmp = x->at(in_i);
+      SumReducer reducer(x->at(in_i));
       nas[0].at(i).add_input(x, in_i);
       for(uint64_t xi = 1; xi < axis_size; xi++){
         uint64_t o_i = xi, tmp_in_i = 0;
@@ -134,10 +129,10 @@ static void SumForward(
           o_i /= x->shape[realAxis[j]];
           tmp_in_i += col * every_xdim_size[realAxis[j]];
         }
-        f(tmp, x->at(in_i+tmp_in_i));
+        reducer.add(x->at(in_i+tmp_in_i));
         nas[0].at(i).add_input(x, in_i+tmp_in_i);
       }
-      y->set_data(i, tmp);
+      y->set_data(i, reducer.result());
       nas[0].at(i).add_output(y, i);
     }
   }
@@ -239,11 +234,56 @@ static void SumInferPrecision(
   oprecs[0] = oprec;
 }
 
+/*
+ * Output index of every input element reduced into, the reduced
+ *  axes are dropped from the input index. Empty axes reduce all
+ *  the elements, or none if exclude.
+ **/
+static std::vector<size_t> ReduceConcreteIndex(
+    NodeAttrs const& attrs, Shape const& xshape) {
+  Shape axis = Shape::from_string(attrs.dict.at("axis"));
+  bool exclude;
+  std::istringstream(attrs.dict.at("exclude")) >> std::boolalpha >> exclude;
+  std::vector<int64_t> realAxis = GetRealAxis(axis, exclude, xshape.size());
+
+  std::vector<bool> flag(xshape.size(), !exclude && realAxis.empty());
+  for (int64_t a : realAxis) flag[a] = true;
+  std::vector<size_t> index(xshape.Size());
+  for (size_t i = 0; i < index.size(); ++i) {
+    size_t x_i = i, y_i = 0, shapeSize = 1;
+    for (int j = xshape.size() - 1; j >= 0; j--) {
+      size_t col = x_i % xshape[j];
+      x_i /= xshape[j];
+      if (flag[j]) continue;
+      y_i += col * shapeSize;
+      shapeSize *= xshape[j];
+    }
+    index[i] = y_i;
+  }
+  return index;
+}
+
+static void SumConcrete(
+    NodeAttrs const& attrs,
+    std::vector<ConcreteTensor> const& inputs,
+    std::vector<ConcreteTensor>& outputs,
+    ConcreteFaults& faults) {
+  ConcreteTensor const& x = inputs.at(0);
+  std::vector<size_t> index = ReduceConcreteIndex(attrs, x.shape);
+  int64_t *y = outputs[0].data.data();
+  bool overflow = false;
+  for (size_t i = 0; i < x.Size(); ++i) {
+    y[index[i]] = concrete::add(y[index[i]], x.data[i], overflow);
+  }
+  faults.check(overflow, "int64 overflow of sum");
+}
+
 Z3_REGISTER_OP(sum)
   .set_num_inputs(1)
   .set_num_outputs(1)
   .set_attr_default(SumAttrDefault)
   .set_forward(SumForward)
+  .set_concrete(SumConcrete)
   .set_infer_shape(SumInferShape)
   .set_infer_precision(SumInferPrecision)
   .set_generator(_sum_prove);
@@ -414,11 +454,27 @@ static void MaxInferPrecision(
   oprecs[0] = iprecs[0];
 }
 
+static void MaxConcrete(
+    NodeAttrs const& attrs,
+    std::vector<ConcreteTensor> const& inputs,
+    std::vector<ConcreteTensor>& outputs,
+    ConcreteFaults& faults) {
+  ConcreteTensor const& x = inputs.at(0);
+  std::vector<size_t> index = ReduceConcreteIndex(attrs, x.shape);
+  ConcreteTensor& y = outputs[0];
+  std::fill(y.data.begin(), y.data.end(),
+            std::numeric_limits<int64_t>::min());
+  for (size_t i = 0; i < x.Size(); ++i) {
+    y.data[index[i]] = concrete::max(y.data[index[i]], x.data[i]);
+  }
+}
+
 Z3_REGISTER_OP(max)
   .set_num_inputs(1)
   .set_num_outputs(1)
   .set_attr_default(MaxAttrDefault)
   .set_forward(MaxForward)
+  .set_concrete(MaxConcrete)
   .set_infer_shape(MaxInferShape)
   .set_infer_precision(MaxInferPrecision);
 }
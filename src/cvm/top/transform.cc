@@ -81,11 +81,36 @@ static void RepeatInferPrecision(
 
 }
 
+static void RepeatConcrete(
+    NodeAttrs const& attrs,
+    std::vector<ConcreteTensor> const& inputs,
+    std::vector<ConcreteTensor>& outputs,
+    ConcreteFaults& faults) {
+  ConcreteTensor const& x = inputs.at(0);
+  ConcreteTensor& y = outputs.at(0);
+  int repeats = std::atoi(attrs.dict.at("repeats").c_str());
+  int axis = std::atoi(attrs.dict.at("axis").c_str());
+  int ndims = x.shape.size();
+  if (axis < 0) axis += ndims;
+  for (size_t i = 0; i < y.Size(); ++i) {
+    size_t o_i = i, in_i = 0, shapeSize = 1;
+    for (int j = ndims - 1; j >= 0; j--) {
+      size_t col = o_i % y.shape[j];
+      o_i /= y.shape[j];
+      if (j == axis) col /= repeats;
+      in_i += col * shapeSize;
+      shapeSize *= x.shape[j];
+    }
+    y.data[i] = x.data[in_i];
+  }
+}
+
 Z3_REGISTER_OP(repeat)
   .set_num_inputs(1)
   .set_num_outputs(1)
   .set_attr_default(RepeatAttrDefault)
   .set_forward(RepeatForward)
+  .set_concrete(RepeatConcrete)
   .set_infer_shape(RepeatInferShape)
   .set_infer_precision(RepeatInferPrecision)
   .set_generator(null_generator);
@@ -185,11 +210,33 @@ static void TileAttrDefault(NodeAttrs& attrs) {
 }
 
 
+static void TileConcrete(
+    NodeAttrs const& attrs,
+    std::vector<ConcreteTensor> const& inputs,
+    std::vector<ConcreteTensor>& outputs,
+    ConcreteFaults& faults) {
+  ConcreteTensor const& x = inputs.at(0);
+  ConcreteTensor& y = outputs.at(0);
+  int xndim = x.shape.size(), yndim = y.shape.size();
+  for (size_t i = 0; i < y.Size(); ++i) {
+    size_t o_i = i, in_i = 0, shapeSize = 1;
+    for (int j = xndim - 1; j >= 0; j--) {
+      int yj = j + yndim - xndim;
+      size_t col = o_i % y.shape[yj];
+      o_i /= y.shape[yj];
+      in_i += col % x.shape[j] * shapeSize;
+      shapeSize *= x.shape[j];
+    }
+    y.data[i] = x.data[in_i];
+  }
+}
+
 Z3_REGISTER_OP(tile)
   .set_num_inputs(1)
   .set_num_outputs(1)
   .set_attr_default(TileAttrDefault)
   .set_forward(TileForward)
+  .set_concrete(TileConcrete)
   .set_infer_shape(TileInferShape)
   .set_infer_precision(TileInferPrecision)
   .set_generator(null_generator);
@@ -248,10 +295,25 @@ static void FlattenInferPrecision(
     oprecs[0] = iprecs.at(0);
 }
 
+/*
+ * Concrete executor of the operators which keep the data in
+ *  order and only change the shape, such as flatten, reshape,
+ *  expand_dims and squeeze.
+ **/
+static void CopyConcrete(
+    NodeAttrs const& attrs,
+    std::vector<ConcreteTensor> const& inputs,
+    std::vector<ConcreteTensor>& outputs,
+    ConcreteFaults& faults) {
+  std::copy(inputs.at(0).data.begin(), inputs.at(0).data.end(),
+            outputs.at(0).data.begin());
+}
+
 Z3_REGISTER_OP(flatten)
   .set_num_inputs(1)
   .set_num_outputs(1)
   .set_forward(FlattenForward)
+  .set_concrete(CopyConcrete)
   .set_infer_shape(FlattenInferShape)
   .set_infer_precision(FlattenInferPrecision)
   .set_generator(_flatten_prove);
@@ -374,11 +436,36 @@ static void ConcatenateInferPrecision(
     }
 }
 
+static void ConcatenateConcrete(
+    NodeAttrs const& attrs,
+    std::vector<ConcreteTensor> const& inputs,
+    std::vector<ConcreteTensor>& outputs,
+    ConcreteFaults& faults) {
+  ConcreteTensor& y = outputs.at(0);
+  int axis = std::stoi(attrs.dict.at("axis"));
+  int ndim = y.shape.size();
+  if (axis < 0) axis += ndim;
+  // Rows of the axes before axis, each row is the inputs in turn.
+  size_t rows = 1, inner = 1;
+  for (int j = 0; j < axis; ++j) rows *= y.shape[j];
+  for (int j = axis + 1; j < ndim; ++j) inner *= y.shape[j];
+  size_t y_row = y.shape[axis] * inner, offset = 0;
+  for (auto const& x : inputs) {
+    size_t x_row = x.shape[axis] * inner;
+    for (size_t r = 0; r < rows; ++r) {
+      std::copy(x.data.begin() + r * x_row, x.data.begin() + (r + 1) * x_row,
+                y.data.begin() + r * y_row + offset);
+    }
+    offset += x_row;
+  }
+}
+
 Z3_REGISTER_OP(concatenate)
   .set_num_inputs(kVarg)
   .set_num_outputs(1)
   .set_attr_default(ConcatenateAttrDefault)
   .set_forward(ConcatenateForward)
+  .set_concrete(ConcatenateConcrete)
   .set_infer_shape(ConcatenateInferShape)
   .set_infer_precision(ConcatenateInferPrecision)
   .set_generator(null_generator);
@@ -447,6 +534,7 @@ Z3_REGISTER_OP(expand_dims)
   .set_num_outputs(1)
   .set_attr_default(ExpandDimsAttrDefault)
   .set_forward(ExpandDimsForward)
+  .set_concrete(CopyConcrete)
   .set_infer_shape(ExpandDimsInferShape)
   .set_infer_precision(ExpandDimsInferPrecision)
   .set_generator(null_generator);
@@ -576,6 +664,7 @@ Z3_REGISTER_OP(reshape)
   .set_num_outputs(1)
   .set_attr_default(ReshapeAttrDefault)
   .set_forward(ReshapeForward)
+  .set_concrete(CopyConcrete)
   .set_infer_shape(ReshapeInferShape)
   .set_infer_precision(ReshapeInferPrecision)
   .set_generator(_reshape_prove);
@@ -664,6 +753,7 @@ Z3_REGISTER_OP(squeeze)
   .set_num_outputs(1)
   .set_attr_default(SqueezeAttrDefault)
   .set_forward(SqueezeForward)
+  .set_concrete(CopyConcrete)
   .set_infer_shape(SqueezeInferShape)
   .set_infer_precision(SqueezeInferPrecision)
   .set_generator(null_generator);
@@ -765,11 +855,41 @@ static void TransposeInferPrecision(
 
 }
 
+static void TransposeConcrete(
+    NodeAttrs const& attrs,
+    std::vector<ConcreteTensor> const& inputs,
+    std::vector<ConcreteTensor>& outputs,
+    ConcreteFaults& faults) {
+  ConcreteTensor const& x = inputs.at(0);
+  ConcreteTensor& y = outputs.at(0);
+  int ndim = y.shape.size();
+  Shape axes = Shape::from_string(attrs.dict.at("axes"));
+  if (axes.empty()) {
+    for (int j = ndim - 1; j >= 0; j--) axes.push_back(j);
+  }
+  for (auto &a : axes) {
+    if (a < 0) a += ndim;
+  }
+  std::vector<size_t> x_stride(ndim, 1);
+  for (int j = ndim - 2; j >= 0; j--) {
+    x_stride[j] = x_stride[j + 1] * x.shape[j + 1];
+  }
+  for (size_t i = 0; i < y.Size(); ++i) {
+    size_t o_i = i, in_i = 0;
+    for (int j = ndim - 1; j >= 0; j--) {
+      in_i += o_i % y.shape[j] * x_stride[axes[j]];
+      o_i /= y.shape[j];
+    }
+    y.data[i] = x.data[in_i];
+  }
+}
+
 Z3_REGISTER_OP(transpose)
   .set_num_inputs(1)
   .set_num_outputs(1)
   .set_attr_default(TransposeAttrDefault)
   .set_forward(TransposeForward)
+  .set_concrete(TransposeConcrete)
   .set_infer_shape(TransposeInferShape)
   .set_infer_precision(TransposeInferPrecision)
   .set_generator(null_generator);
@@ -898,11 +1018,44 @@ static void StridedSliceForward(
   }
 }
 
+static void StridedSliceConcrete(
+    NodeAttrs const& attrs,
+    std::vector<ConcreteTensor> const& inputs,
+    std::vector<ConcreteTensor>& outputs,
+    ConcreteFaults& faults) {
+  ConcreteTensor const& x = inputs.at(0);
+  ConcreteTensor& y = outputs.at(0);
+  Shape begin = Shape::from_string(attrs.dict.at("begin"));
+  Shape stride = Shape::from_string(attrs.dict.at("stride"));
+  int ndim = x.shape.size();
+  // Begin is clamped into the axis, as cvm-runtime does.
+  std::vector<int64_t> begin_vec(ndim, 0), stride_vec(ndim, 1);
+  for (int j = 0; j < ndim; ++j) {
+    if (j < int(stride.size())) stride_vec[j] = stride[j];
+    int64_t b = j < int(begin.size()) ? begin[j] : 0;
+    if (b < 0) b += x.shape[j];
+    int64_t lo = stride_vec[j] < 0 ? -1 : 0;
+    int64_t hi = stride_vec[j] < 0 ? x.shape[j] - 1 : x.shape[j];
+    begin_vec[j] = std::min(std::max(b, lo), hi);
+  }
+  for (size_t i = 0; i < y.Size(); ++i) {
+    size_t o_i = i, in_i = 0, shapeSize = 1;
+    for (int j = ndim - 1; j >= 0; j--) {
+      int64_t col = o_i % y.shape[j];
+      o_i /= y.shape[j];
+      in_i += (begin_vec[j] + col * stride_vec[j]) * shapeSize;
+      shapeSize *= x.shape[j];
+    }
+    y.data[i] = x.data[in_i];
+  }
+}
+
 Z3_REGISTER_OP(slice)
   .set_num_inputs(1)
   .set_num_outputs(1)
   .set_attr_default(StridedSliceAttrDefault)
   .set_forward(StridedSliceForward)
+  .set_concrete(StridedSliceConcrete)
   .set_infer_shape(StridedSliceInferShape)
   .set_infer_precision(StridedSliceInferPrecision)
   .set_generator(null_generator);
@@ -988,11 +1141,31 @@ static void SliceLikeInferPrecision(
 
 }
 
+static void SliceLikeConcrete(
+    NodeAttrs const& attrs,
+    std::vector<ConcreteTensor> const& inputs,
+    std::vector<ConcreteTensor>& outputs,
+    ConcreteFaults& faults) {
+  ConcreteTensor const& x = inputs.at(0);
+  ConcreteTensor& y = outputs.at(0);
+  int ndim = y.shape.size();
+  for (size_t i = 0; i < y.Size(); ++i) {
+    size_t o_i = i, in_i = 0, shapeSize = 1;
+    for (int j = ndim - 1; j >= 0; j--) {
+      in_i += o_i % y.shape[j] * shapeSize;
+      o_i /= y.shape[j];
+      shapeSize *= x.shape[j];
+    }
+    y.data[i] = x.data[in_i];
+  }
+}
+
 Z3_REGISTER_OP(slice_like)
   .set_num_inputs(2)
   .set_num_outputs(1)
   .set_attr_default(SliceLikeAttrDefault)
   .set_forward(SliceLikeForward)
+  .set_concrete(SliceLikeConcrete)
   .set_infer_shape(SliceLikeInferShape)
   .set_infer_precision(SliceLikeInferPrecision)
   .set_generator(null_generator);
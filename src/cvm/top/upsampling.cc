@@ -70,6 +70,27 @@ void UpsamplingForward(
   }
 }
 
+static void UpsamplingConcrete(
+    NodeAttrs const& attrs,
+    std::vector<ConcreteTensor> const& inputs,
+    std::vector<ConcreteTensor>& outputs,
+    ConcreteFaults& faults) {
+  int scale = std::stoi(attrs.dict.at("scale"));
+  ConcreteTensor const& x = inputs.at(0);
+  ConcreteTensor& y = outputs.at(0);
+  size_t h = x.shape[2], w = x.shape[3];
+  size_t oh = y.shape[2], ow = y.shape[3];
+  for (size_t nc = 0; nc < size_t(y.shape[0] * y.shape[1]); ++nc) {
+    const int64_t *xc = x.data.data() + nc * h * w;
+    int64_t *yc = y.data.data() + nc * oh * ow;
+    for (size_t yi = 0; yi < oh; ++yi) {
+      for (size_t xi = 0; xi < ow; ++xi) {
+        yc[yi * ow + xi] = xc[yi / scale * w + xi / scale];
+      }
+    }
+  }
+}
+
 Z3_REGISTER_OP(upsampling)
   .set_num_inputs(1)
   .set_num_outputs(1)
@@ -77,6 +98,7 @@ Z3_REGISTER_OP(upsampling)
   .set_infer_shape(UpsamplingInferShape)
   .set_infer_precision(UpsamplingInferPrecision)
   .set_forward(UpsamplingForward)
+  .set_concrete(UpsamplingConcrete)
   .set_generator(null_generator);
 
 }
@@ -1,13 +1,22 @@
 #include <iostream>
+#include <algorithm>
 #include <fstream>
+#include <sstream>
 #include <unordered_map>
+#include <chrono>
 #include <ctime>
 #include <cstdio>
 #include <cstdlib>
+#include <random>
+#include <sys/resource.h>
 
 #include "cvm/z3_types.h"
 #include "cvm/op.h"
 #include "cvm/node.h"
+#include "cvm/graph.h"
+#include "cvm/params.h"
+#include "cvm/prover.h"
+#include "cvm/proof_cache.h"
 
 using namespace z3::cvm;
 using namespace z3::type;
@@ -18,13 +27,14 @@ using namespace std;
   if (&os != &std::cout) \
     std::cout << msg << std::endl;
 
-void z3_prover(z3_cstr cstr, ostream &os=cout) {
+/*
+ * Check the obligation, the counterexample is replayed on the
+ *  concrete executor of node if given.
+ **/
+void z3_prover(z3_cstr cstr, ostream &os=cout, Node *node=nullptr) {
   z3::solver s(C);
-#if SIMPLIFY_LEVEL <= 6
-  s.add(!cstr);
-#else
-  s.add((!cstr).simplify());
-#endif
+  if (GetSimplifyLevel() <= 6) s.add(!cstr);
+  else s.add((!cstr).simplify());
 
   os << "===== Z3_PROVER =====\n" 
     << s
@@ -41,13 +51,19 @@ void z3_prover(z3_cstr cstr, ostream &os=cout) {
         z3::func_decl v = m[i];
         // this problem contains only constants
         // assert(v.arity() == 0);
-        os << v.name() << " = ";
+        os << SymbolTable::Get()->name(v.name()) << " = ";
         if (v.arity() == 0)
           os << m.get_const_interp(v);
         else
           os << m.get_func_interp(v);
         os << "\n";
       }
+      if (node != nullptr) {
+        ReplayVerdict verdict = node->replay(m);
+        DOUBLE_LOG("The counterexample is " <<
+            (verdict.confirmed ? "confirmed" : "not reproduced") <<
+            ": " << verdict.detail);
+      }
       break;
     }
     case z3::unknown: {
@@ -61,6 +77,171 @@ void z3_prover(z3_cstr cstr, ostream &os=cout) {
     << "s" << std::endl;
 }
 
+/*
+ * Number of concurrent prover workers, set via command line
+ *  argument `workers=N`. Sequential z3_prover is used if less
+ *  than 2 workers.
+ **/
+static size_t num_workers = 1;
+/*
+ * Check obligations of node in incremental ProveSession,
+ *  set via command line argument `incremental=true`.
+ **/
+static bool incremental = false;
+/*
+ * Deduplicate all the obligations of node by alpha-canonical
+ *  form instead of the uid set by operator, set via command
+ *  line argument `canonical=true`.
+ **/
+static bool canonical = false;
+/*
+ * Persistent proof cache, opened via command line argument
+ *  `cache=<path>`.
+ **/
+static std::unique_ptr<ProofCache> proof_cache;
+/*
+ * Close data-movement obligations without solver, set via
+ *  command line argument `syntactic=true`.
+ **/
+static bool syntactic = false;
+/*
+ * Close range obligations by interval analysis without solver,
+ *  set via command line argument `interval=true`.
+ **/
+static bool interval_analysis = false;
+/*
+ * Close the outputs of dense and conv2d by chaining the lemma
+ *  of multiply-accumulate, set via command line argument
+ *  `compositional=true`.
+ **/
+static bool compositional = false;
+/*
+ * Check obligations over the smallest sound bit-vector width
+ *  instead of 64 bits, set via command line argument
+ *  `width=adaptive`.
+ **/
+static bool adaptive_width = false;
+/*
+ * Verify the model assume-guarantee, every operator output used
+ *  by another operator is cut into its precision contract, set
+ *  via command line argument `contracts=true`.
+ **/
+static bool contracts = false;
+/*
+ * Reuse the verdicts of node with the same signature verified
+ *  earlier in the model, see Node::signature, set via command
+ *  line argument `memo=true`.
+ **/
+static bool memo = false;
+/*
+ * Walk the model and release every node once its consumers are
+ *  verified instead of keeping the whole graph, set via command
+ *  line argument `release=true`.
+ **/
+static bool release = false;
+/*
+ * Concrete weights of model, bound to the variables of the same
+ *  name, set via command line argument `params=<path>`.
+ **/
+static std::unique_ptr<Params> params;
+/*
+ * Escalation ladder of every obligation, built from command
+ *  line arguments `timeout=<ms>` and `rlimit=<n>`.
+ **/
+static ProveLadder ladder;
+/*
+ * Race tactic strategies on every obligation, set via command
+ *  line argument `portfolio=true`, with the same budget.
+ **/
+static ProveLadder portfolio;
+/*
+ * Capacity of the queue between building and solving of
+ *  obligations, which overlap in pipeline, set via command
+ *  line argument `pipeline=N`, 0 disables.
+ **/
+static size_t pipeline = 0;
+
+static Prover& prover() {
+  static Prover prover(num_workers);
+  return prover;
+}
+
+/*
+ * Report the result, and replay the counterexample of it through
+ *  the concrete executor of node, as z3_prover does. The model
+ *  of worker is rebuilt in the global context.
+ **/
+static void report_result(ProveResult const& r, NodePtr const& node,
+                          ostream &os) {
+  r.report(os);
+  if (r.status != ProveStatus::kUndeterministic) return;
+  z3::model m(C);
+  if (!r.rebuild(C, &m)) {
+    DOUBLE_LOG("The counterexample is not replayed: "
+        "only the text is kept, such as of proof cache or of "
+        "alpha-equivalent obligation");
+    return;
+  }
+  ReplayVerdict verdict = node->replay(m);
+  DOUBLE_LOG("The counterexample is " <<
+      (verdict.confirmed ? "confirmed" : "not reproduced") <<
+      ": " << verdict.detail);
+}
+
+void prove_node(NodePtr const& node, ostream &os=cout) {
+  SimplifyScope scope(node->is_variable() ? -1 : node->op()->simplify_level);
+  std::vector<bool> closed;
+  if (compositional) closed = node->compositional_discharge();
+  size_t num_closed = std::count(closed.begin(), closed.end(), true);
+  if (num_closed > 0) {
+    os << num_closed << " outputs discharged by mac lemma" << std::endl;
+  }
+  bool passes = canonical || syntactic || interval_analysis ||
+    adaptive_width || proof_cache || !portfolio.empty();
+  // Sequential provers stream the obligations one at a time.
+  ObligationCursor cursor = node->obligations(!canonical, closed);
+  z3_expr p(true);
+  if (num_workers < 2 && !passes && !incremental && ladder.empty()) {
+    while (cursor.next(&p)) z3_prover(p.cstr, os, node.get());
+    return;
+  }
+  if (num_workers < 2 && !passes && incremental) {
+    ProveSession session(C, node->background().cstr, ladder);
+    while (cursor.next(&p)) {
+      report_result(session.prove(p.cstr), node, os);
+    }
+    return;
+  }
+  if (pipeline > 0 && !canonical && !adaptive_width && !proof_cache) {
+    prover().set_syntactic(syntactic)
+      .set_interval(interval_analysis)
+      .set_ladder(ladder)
+      .set_portfolio(portfolio);
+    prover().prove_stream(
+        cursor, incremental ? node->background() : z3_expr(true),
+        [&](ProveResult const& r) {
+          // Workers translate from the global context meanwhile.
+          std::lock_guard<std::mutex> lock(Z3ContextMutex());
+          report_result(r, node, os);
+        },
+        node->op(), pipeline);
+    return;
+  }
+  std::vector<z3_expr> proves =
+    node->provements_generator(!canonical, closed);
+  prover().set_canonical(canonical)
+    .set_syntactic(syntactic)
+    .set_interval(interval_analysis)
+    .set_adaptive_width(adaptive_width)
+    .set_ladder(ladder)
+    .set_portfolio(portfolio)
+    .set_cache(proof_cache.get());
+  std::vector<ProveResult> results = prover().prove(
+      proves, incremental ? node->background() : z3_expr(true),
+      node->op());
+  for (auto &r : results) report_result(r, node, os);
+}
+
 void z3_expr_deterministic() {
   z3_expr a("a"), b("b");
   z3_expr cstr = a.deterministic() && b.deterministic();
@@ -118,8 +299,7 @@ void test_dense(){
              {"units", st},
              {"use_bias", "false"},
            });
-           for (auto &p : ret.node->provements_generator(true))
-             z3_prover(p.cstr);
+           prove_node(ret.node);
       }
     }
   }
@@ -138,8 +318,7 @@ void test_elemwise_add(){
              "elemwise_add", "eadd", {a, b},
              unordered_map<string, string>{
            });
-           for (auto &p : ret.node->provements_generator(true))
-             z3_prover(p.cstr);
+           prove_node(ret.node);
         }
       }
     }
@@ -158,8 +337,7 @@ void test_relu(){
              "relu", "relu", {a},
              unordered_map<string, string>{
            });
-           for (auto &p : ret.node->provements_generator(true))
-             z3_prover(p.cstr);
+           prove_node(ret.node);
         }
       }
     }
@@ -180,8 +358,7 @@ void test_clip(){
                 {"a_max", "10"},
                 {"a_min", "-19"}
            });
-           for (auto &p : ret.node->provements_generator(true))
-             z3_prover(p.cstr);
+           prove_node(ret.node);
         }
       }
     }
@@ -200,8 +377,7 @@ void test_flatten(){
              "flatten", "flt", {a},
              unordered_map<string, string>{
            });
-           for (auto &p : ret.node->provements_generator(true))
-             z3_prover(p.cstr);
+           prove_node(ret.node);
         }
       }
     }
@@ -221,8 +397,7 @@ void test_repeat(){
              unordered_map<string, string>{
                 {"repeats", "2"}
            });
-           for (auto &p : ret.node->provements_generator(true))
-             z3_prover(p.cstr);
+           prove_node(ret.node);
         }
       }
     }
@@ -242,8 +417,7 @@ void test_upsampling(){
              unordered_map<string, string>{
                 {"scale", "2"}
            });
-           for (auto &p : ret.node->provements_generator(true))
-             z3_prover(p.cstr);
+           prove_node(ret.node);
         }
       }
     }
@@ -263,8 +437,7 @@ void test_concatenate(){
             "concatenate", "concat", {a, b},
              unordered_map<string, string>{
            });
-           for (auto &p : ret.node->provements_generator(true))
-             z3_prover(p.cstr);
+           prove_node(ret.node);
         }
       }
     }
@@ -284,8 +457,7 @@ void test_expand_dims(){
              unordered_map<string, string>{
                 {"axis", "2"},
            });
-           for (auto &p : ret.node->provements_generator(true))
-             z3_prover(p.cstr);
+           prove_node(ret.node);
         }
       }
     }
@@ -304,8 +476,7 @@ void test_squeeze(){
             "squeeze", "squeeze", {a},
              unordered_map<string, string>{
            });
-           for (auto &p : ret.node->provements_generator(true))
-             z3_prover(p.cstr);
+           prove_node(ret.node);
         }
       }
     }
@@ -324,8 +495,7 @@ void test_transpose(){
             "transpose", "trp", {a},
              unordered_map<string, string>{
            });
-           for (auto &p : ret.node->provements_generator(true))
-             z3_prover(p.cstr);
+           prove_node(ret.node);
         }
       }
     }
@@ -345,8 +515,7 @@ void test_tile(){
              unordered_map<string, string>{
               {"reps", "(2,    2,   3,     )"},
            });
-           for (auto &p : ret.node->provements_generator(true))
-             z3_prover(p.cstr);
+           prove_node(ret.node);
         }
       }
     }
@@ -365,8 +534,7 @@ void test_slice(){
             "slice", "slice", {a},
              unordered_map<string, string>{
            });
-           for (auto &p : ret.node->provements_generator(true))
-             z3_prover(p.cstr);
+           prove_node(ret.node);
         }
       }
     }
@@ -387,8 +555,7 @@ void test_reshape(){
              unordered_map<string, string>{
               {"shape", st},
            });
-           for (auto &p : ret.node->provements_generator(true))
-             z3_prover(p.cstr);
+           prove_node(ret.node);
         }
       }
     }
@@ -411,8 +578,7 @@ void test_cvm_clip(){
                 {"a_min", "-19"},
                 {"precision", "2"},
            });
-           for (auto &p : ret.node->provements_generator(true))
-             z3_prover(p.cstr);
+           prove_node(ret.node);
         }
       }
     }
@@ -434,8 +600,7 @@ void test_slice_like(){
              unordered_map<string, string>{
               {"axis", "(0, 1)"},
            });
-           for (auto &p : ret.node->provements_generator(true))
-             z3_prover(p.cstr);
+           prove_node(ret.node);
         }
       }
     }
@@ -455,8 +620,7 @@ void test_abs(){
             "abs", "abs", {a},
              unordered_map<string, string>{
            });
-           for (auto &p : ret.node->provements_generator(true))
-             z3_prover(p.cstr);
+           prove_node(ret.node);
         }
       }
     }
@@ -478,8 +642,7 @@ void test_cvm_right_shift(){
               {"precision", "2"},
               {"shift_bit", "2"},
            });
-           for (auto &p : ret.node->provements_generator(true))
-             z3_prover(p.cstr);
+           prove_node(ret.node);
         }
       }
     }
@@ -501,8 +664,7 @@ void test_cvm_left_shift(){
               {"precision", "2"},
               {"shift_bit", "2"},
            });
-           for (auto &p : ret.node->provements_generator(true))
-             z3_prover(p.cstr);
+           prove_node(ret.node);
         }
       }
     }
@@ -523,8 +685,7 @@ void test_broadcast_add(){
             "broadcast_add", "badd", {a, b},
              unordered_map<string, string>{
            });
-           for (auto &p : ret.node->provements_generator(true))
-             z3_prover(p.cstr);
+           prove_node(ret.node);
         }
       }
     }
@@ -545,8 +706,7 @@ void test_broadcast_sub(){
             "broadcast_sub", "bsub", {a, b},
              unordered_map<string, string>{
            });
-           for (auto &p : ret.node->provements_generator(true))
-             z3_prover(p.cstr);
+           prove_node(ret.node);
         }
       }
     }
@@ -566,8 +726,7 @@ void test_broadcast_mul(){
             "broadcast_mul", "bmul", {a, b},
              unordered_map<string, string>{
            });
-           for (auto &p : ret.node->provements_generator(true))
-             z3_prover(p.cstr);
+           prove_node(ret.node);
         }
       }
   }
@@ -587,8 +746,7 @@ void test_broadcast_div(){
             "broadcast_div", "bdiv", {a, b},
              unordered_map<string, string>{
            });
-           for (auto &p : ret.node->provements_generator(true))
-             z3_prover(p.cstr);
+           prove_node(ret.node);
         }
       }
     }
@@ -614,8 +772,7 @@ void test_conv2d(){
               {"channels", st},
               {"kernel_size", st1},
            });
-           for (auto &p : ret.node->provements_generator(true))
-             z3_prover(p.cstr);
+           prove_node(ret.node);
         }
       }
     }
@@ -636,8 +793,7 @@ void test_broadcast_max(){
             "broadcast_max", "bmax", {a, b},
              unordered_map<string, string>{
            });
-           for (auto &p : ret.node->provements_generator(true))
-             z3_prover(p.cstr);
+           prove_node(ret.node);
         }
       }
     }
@@ -658,8 +814,7 @@ void test_maxpool2d(){
              unordered_map<string, string>{
             {"pool_size", "(1, 2)"},
            });
-           for (auto &p : ret.node->provements_generator(true))
-             z3_prover(p.cstr);
+           prove_node(ret.node);
         }
       }
     }
@@ -680,8 +835,7 @@ void test_sum(){
              unordered_map<string, string>{
               {"axis", "(1, )"},
            });
-           for (auto &p : ret.node->provements_generator(true))
-             z3_prover(p.cstr);
+           prove_node(ret.node);
         }
       }
     }
@@ -701,8 +855,7 @@ void test_max(){
             "max", "max", {a},
              unordered_map<string, string>{
            });
-           for (auto &p : ret.node->provements_generator(true))
-             z3_prover(p.cstr);
+           prove_node(ret.node);
         }
       }
     }
@@ -796,14 +949,689 @@ void big_test(std::string op_name){
   }
 }
 
-int main() {
+struct BenchCase {
+  std::string op;
+  std::vector<Shape> shapes;
+  unordered_map<string, string> attrs;
+};
+
+/*
+ * Operators of benchmarks with small inputs, so that every
+ *  obligation can be checked within seconds.
+ **/
+static std::vector<BenchCase> bench_cases() {
+  return {
+    {"elemwise_add", {{1, 4}, {1, 4}}, {}},
+    {"elemwise_sub", {{1, 4}, {1, 4}}, {}},
+    {"relu", {{1, 4}}, {}},
+    {"clip", {{1, 4}}, {{"a_max", "10"}, {"a_min", "-19"}}},
+    {"cvm_clip", {{1, 4}}, {{"precision", "8"}}},
+    {"abs", {{1, 4}}, {}},
+    {"negative", {{1, 4}}, {}},
+    {"broadcast_max", {{2, 3}, {2, 1}}, {}},
+    {"max", {{2, 3}}, {{"axis", "(1, )"}}},
+    {"sum", {{2, 3}}, {{"axis", "(1, )"}}},
+    {"cvm_right_shift", {{1, 4}}, {{"shift_bit", "2"}, {"precision", "8"}}},
+    {"cvm_left_shift", {{1, 4}}, {{"shift_bit", "2"}, {"precision", "8"}}},
+    {"broadcast_mul", {{2, 3}, {2, 1}}, {}},
+    {"dense", {{1, 3}, {2, 3}}, {{"units", "2"}, {"use_bias", "false"}}},
+  };
+}
+
+static NodeEntry bench_node(BenchCase const& c) {
+  std::vector<NodeEntry> inputs;
+  for (size_t i = 0; i < c.shapes.size(); ++i) {
+    inputs.push_back(Node::CreateVariable<TypeRef>(
+          std::string(1, 'a' + i), c.shapes[i]));
+  }
+  return Node::CreateOperator(c.op.c_str(), "o", inputs, c.attrs);
+}
+
+/*
+ * Benchmark of theory backends, every operator is built with
+ *  small inputs in each theory, and all the obligations are
+ *  checked with the ladder of same budget. The default budget
+ *  is resource limit instead of timeout, since z3 may miss the
+ *  timeout on nonlinear integer obligations.
+ **/
+void bench_theory(unsigned timeout, unsigned rlimit) {
+  std::vector<BenchCase> cases = bench_cases();
+  if (timeout == 0 && rlimit == 0) rlimit = 20000000;
+  Theory theories[] = {Theory::kBitVector, Theory::kInteger};
+  for (auto const& c : cases) {
+    for (Theory theory : theories) {
+      SetTheory(theory);
+      ProveLadder budget = default_ladder(timeout, rlimit);
+      auto ret = bench_node(c);
+      std::vector<z3_expr> proves = ret.node->provements_generator(true);
+      size_t proved = 0, failed = 0;
+      clock_t start = clock();
+      for (auto &p : proves) {
+        ProveResult r = prove_in_context(C, p.cstr, budget);
+        if (r.status == ProveStatus::kDeterministic) proved++;
+        if (r.status == ProveStatus::kUndeterministic) failed++;
+      }
+      double time = double(clock() - start) / CLOCKS_PER_SEC;
+      std::cout << c.op << " "
+        << (theory == Theory::kInteger ? "int" : "bv")
+        << ": proved " << proved << "/" << proves.size()
+        << ", failed " << failed
+        << ", time " << time << "s" << std::endl;
+    }
+  }
+  SetTheory(Theory::kBitVector);
+}
+
+/*
+ * Benchmark of simplify levels, every operator is built and
+ *  checked at each level with the same budget, and the level of
+ *  least total time among the ones proving the most obligations
+ *  is suggested, which can be set via `simplify.<op>=<level>`.
+ **/
+void bench_simplify(unsigned timeout, unsigned rlimit,
+                    std::vector<int> const& levels) {
+  if (timeout == 0 && rlimit == 0) rlimit = 20000000;
+  ProveLadder budget = default_ladder(timeout, rlimit);
+  int global = GetSimplifyLevel();
+  for (auto const& c : bench_cases()) {
+    int best = -1;
+    size_t best_proved = 0;
+    double best_time = 0;
+    for (int level : levels) {
+      SetSimplifyLevel(level);
+      clock_t start = clock();
+      auto ret = bench_node(c);
+      std::vector<z3_expr> proves = ret.node->provements_generator(true);
+      double build = double(clock() - start) / CLOCKS_PER_SEC;
+      size_t proved = 0, failed = 0;
+      start = clock();
+      for (auto &p : proves) {
+        ProveResult r = prove_in_context(C, p.cstr, budget);
+        if (r.status == ProveStatus::kDeterministic) proved++;
+        if (r.status == ProveStatus::kUndeterministic) failed++;
+      }
+      double check = double(clock() - start) / CLOCKS_PER_SEC;
+      std::cout << c.op << " level " << level
+        << ": proved " << proved << "/" << proves.size()
+        << ", failed " << failed
+        << ", build " << build << "s, check " << check << "s"
+        << std::endl;
+      if (best < 0 || proved > best_proved ||
+          (proved == best_proved && build + check < best_time)) {
+        best = level;
+        best_proved = proved;
+        best_time = build + check;
+      }
+    }
+    std::cout << c.op << " best level " << best
+      << ", time " << best_time << "s" << std::endl;
+  }
+  SetSimplifyLevel(global);
+}
+
+/*
+ * Benchmark of reduction modes on the shape sweeps of dense and
+ *  conv2d tests, every node is built in each mode, and the first
+ *  `samples` obligations are checked with the same budget, with
+ *  interval and adaptive width passes of command line.
+ **/
+void bench_reduce(unsigned timeout, unsigned rlimit, size_t samples) {
+  std::vector<BenchCase> cases;
+  for (int i = 1; i < 33; i+=13) {
+    for (int j = 1; j < 33; j+=11) {
+      for (int l = 1; l < 33; l+=17) {
+        cases.push_back({"dense", {{i, j}, {l, j}},
+            {{"units", std::to_string(l)}, {"use_bias", "false"}}});
+      }
+    }
+  }
+  for (int j = 1; j < 10; j+=3) {
+    for (int l = 1; l <= 10; l+=4) {
+      for (int r = 1; r <= 10; r+=2) {
+        cases.push_back({"conv2d", {{1, j, l, r}, {1, j, l, r}, {1}},
+            {{"channels", std::to_string(j)},
+             {"kernel_size", "(" + std::to_string(l) + ", " +
+               std::to_string(r) + ")"}}});
+      }
+    }
+  }
+  if (timeout == 0 && rlimit == 0) rlimit = 20000000;
+  prover().set_interval(interval_analysis)
+    .set_adaptive_width(adaptive_width)
+    .set_ladder(default_ladder(timeout, rlimit));
+  ReduceMode modes[] = {ReduceMode::kLinear, ReduceMode::kTree};
+  std::map<std::string, double> total;
+  std::map<std::string, size_t> total_proved;
+  for (auto const& c : cases) {
+    for (ReduceMode mode : modes) {
+      SetReduceMode(mode);
+      std::string name = c.op + (mode == ReduceMode::kTree ?
+          " tree" : " linear");
+      auto ret = bench_node(c);
+      std::vector<z3_expr> proves = ret.node->provements_generator(true);
+      if (proves.size() > samples) {
+        proves.erase(proves.begin() + samples, proves.end());
+      }
+      size_t proved = 0, failed = 0;
+      clock_t start = clock();
+      for (auto &r : prover().prove(proves)) {
+        if (r.status == ProveStatus::kDeterministic) proved++;
+        if (r.status == ProveStatus::kUndeterministic) failed++;
+      }
+      double time = double(clock() - start) / CLOCKS_PER_SEC;
+      total[name] += time;
+      total_proved[name] += proved;
+      std::cout << name;
+      for (auto const& shp : c.shapes) std::cout << " " << shp.to_string();
+      std::cout << ": proved " << proved << "/" << proves.size()
+        << ", failed " << failed
+        << ", time " << time << "s" << std::endl;
+    }
+  }
+  for (auto const& t : total) {
+    std::cout << t.first << " total: proved " << total_proved[t.first]
+      << ", time " << t.second << "s" << std::endl;
+  }
+  SetReduceMode(ReduceMode::kLinear);
+}
+
+/*
+ * Equivalence of reduction modes, dense, conv2d, sum and max are
+ *  built on the same inputs in linear and tree mode, and every
+ *  pair of output elements is proved equal, so that tree mode
+ *  only reassociates the accumulation.
+ **/
+void compare_reduce(unsigned timeout, unsigned rlimit) {
+  std::vector<BenchCase> cases = {
+    {"dense", {{2, 5}, {3, 5}, {3}}, {{"units", "3"}}},
+    {"dense", {{1, 9}, {2, 9}}, {{"units", "2"}, {"use_bias", "false"}}},
+    {"conv2d", {{1, 2, 4, 4}, {3, 2, 3, 3}, {3}},
+      {{"channels", "3"}, {"kernel_size", "(3, 3)"},
+       {"padding", "(1, 1)"}}},
+    {"conv2d", {{1, 3, 3, 3}, {2, 3, 2, 2}},
+      {{"channels", "2"}, {"kernel_size", "(2, 2)"},
+       {"use_bias", "false"}}},
+    {"sum", {{2, 3, 4}}, {{"axis", "(0, 2)"}}},
+    {"sum", {{2, 5}}, {{"axis", "(1, )"}, {"keepdims", "true"}}},
+    {"max", {{2, 3, 4}}, {{"axis", "(0, 2)"}}},
+    {"max", {{2, 5}}, {{"axis", "(1, )"}}},
+  };
+  if (timeout == 0 && rlimit == 0) rlimit = 20000000;
+  ProveLadder budget = default_ladder(timeout, rlimit);
+  size_t failed = 0;
+  for (auto const& c : cases) {
+    std::vector<NodeEntry> inputs;
+    for (size_t i = 0; i < c.shapes.size(); ++i) {
+      inputs.push_back(Node::CreateVariable<TypeRef>(
+            std::string(1, 'a' + i), c.shapes[i]));
+    }
+    SetReduceMode(ReduceMode::kLinear);
+    auto linear = Node::CreateOperator(
+        c.op.c_str(), "linear", inputs, c.attrs);
+    SetReduceMode(ReduceMode::kTree);
+    auto tree = Node::CreateOperator(
+        c.op.c_str(), "tree", inputs, c.attrs);
+    SetReduceMode(ReduceMode::kLinear);
+
+    TypePtr const& a = linear.operator->();
+    TypePtr const& b = tree.operator->();
+    size_t equal = 0;
+    clock_t start = clock();
+    for (size_t i = 0; i < a->Size(); ++i) {
+      ProveResult r = prove_in_context(
+          C, a->assigned(i).data == b->assigned(i).data, budget);
+      if (r.status == ProveStatus::kDeterministic) equal++;
+    }
+    double time = double(clock() - start) / CLOCKS_PER_SEC;
+    if (equal != a->Size()) failed++;
+    std::cout << c.op;
+    for (auto const& shp : c.shapes) std::cout << " " << shp.to_string();
+    std::cout << ": equal " << equal << "/" << a->Size()
+      << ", time " << time << "s" << std::endl;
+  }
+  std::cout << "Reduce: " << failed << " of " << cases.size()
+    << " operators differ between linear and tree" << std::endl;
+}
+
+// Interpret the constant symbol e as value v in model m.
+static void bind_const(z3::model &m, z3::expr const& e, int64_t v) {
+  z3::func_decl f = e.decl();
+  z3::expr val = e.is_bv() ?
+    C.bv_val(v, e.get_sort().bv_size()) : C.int_val(v);
+  m.add_const_interp(f, val);
+}
+
+/*
+ * Operators of differential test, which cover every concrete
+ *  executor, with paddings, strides, groups, bias and axes,
+ *  except get_valid_counts whose forward is a stub.
+ **/
+static std::vector<BenchCase> oracle_cases() {
+  std::vector<BenchCase> cases = bench_cases();
+  std::vector<BenchCase> more = {
+    {"cvm_right_shift", {{1, 4}}, {{"shift_bit", "1"}, {"precision", "8"}}},
+    {"broadcast_add", {{2, 3}, {3}}, {}},
+    {"broadcast_sub", {{2, 1, 3}, {2, 1}}, {}},
+    {"broadcast_div", {{2, 3}, {2, 1}}, {}},
+    {"dense", {{2, 3}, {2, 3}, {2}}, {{"units", "2"}}},
+    {"conv2d", {{1, 2, 4, 4}, {3, 2, 3, 3}, {3}},
+      {{"channels", "3"}, {"kernel_size", "(3, 3)"},
+       {"padding", "(1, 1)"}, {"strides", "(2, 2)"}}},
+    {"conv2d", {{1, 2, 5, 5}, {2, 2, 2, 2}},
+      {{"channels", "2"}, {"kernel_size", "(2, 2)"},
+       {"dilation", "(2, 2)"}, {"use_bias", "false"}}},
+    {"conv2d", {{1, 4, 3, 3}, {4, 1, 3, 3}},
+      {{"channels", "4"}, {"kernel_size", "(3, 3)"}, {"groups", "4"},
+       {"padding", "(1, 1)"}, {"use_bias", "false"}}},
+    {"max_pool2d", {{1, 2, 4, 4}},
+      {{"pool_size", "(2, 2)"}, {"strides", "(2, 2)"}}},
+    {"max_pool2d", {{1, 1, 3, 3}},
+      {{"pool_size", "(3, 3)"}, {"padding", "(1, 1)"}}},
+    {"sum", {{2, 3, 4}}, {{"axis", "(0, 2)"}}},
+    {"sum", {{2, 3, 4}}, {{"axis", "(1, )"}, {"keepdims", "true"}}},
+    {"max", {{2, 3, 2}}, {{"axis", "(1, )"}, {"exclude", "true"}}},
+    {"repeat", {{2, 3}}, {{"repeats", "2"}, {"axis", "1"}}},
+    {"tile", {{2, 3}}, {{"reps", "(2, 1, 2)"}}},
+    {"flatten", {{2, 3, 2}}, {}},
+    {"concatenate", {{2, 3}, {2, 2}}, {{"axis", "1"}}},
+    {"expand_dims", {{2, 3}}, {{"axis", "1"}}},
+    {"reshape", {{2, 3}}, {{"shape", "(3, 2)"}}},
+    {"squeeze", {{2, 1, 3}}, {}},
+    {"transpose", {{2, 3, 4}}, {{"axes", "(1, 0, 2)"}}},
+    {"transpose", {{2, 3, 4}}, {}},
+    {"slice", {{3, 4}}, {{"begin", "(1, 0)"}, {"end", "(3, 4)"},
+                         {"stride", "(1, 2)"}}},
+    {"slice_like", {{3, 4}, {2, 3}}, {}},
+    {"upsampling", {{1, 2, 2, 3}}, {{"scale", "2"}}},
+  };
+  cases.insert(cases.end(), more.begin(), more.end());
+  return cases;
+}
+
+/*
+ * Differential test of forward functions against the concrete
+ *  executors. Every operator is fed with `samples` random inputs
+ *  of random precision in [1, 8], the outputs of forward are
+ *  evaluated and compared with the concrete ones.
+ **/
+void bench_oracle(size_t samples) {
+  std::mt19937 rng(0);
+  size_t total = 0, failed = 0;
+  for (auto const& c : oracle_cases()) {
+    NodeEntry ret;
+    size_t mismatched = 0;
+    std::string first;
+    try {
+      ret = bench_node(c);
+    } catch (std::exception const& e) {
+      // Forward fails for all the samples, such as out of index.
+      mismatched = samples;
+      std::istringstream iss(e.what());
+      for (std::string line; std::getline(iss, line);) {
+        if (!line.empty()) first = "forward throws " + line;
+      }
+    }
+    clock_t start = clock();
+    for (size_t s = 0; ret.node && s < samples; ++s) {
+      z3::model m(C);
+      for (auto &e : ret.node->inputs) {
+        TypePtr const& tp = e.operator->();
+        int prec = std::uniform_int_distribution<int>(1, 8)(rng);
+        int64_t r = (int64_t(1) << (prec - 1)) - 1;
+        std::uniform_int_distribution<int64_t> value(-r, r);
+        bind_const(m, tp->prec.data, prec);
+        for (size_t i = 0; i < tp->Size(); ++i) {
+          bind_const(m, tp->at(i).data, value(rng));
+        }
+      }
+      std::string mismatch = ret.node->differential(m);
+      if (!mismatch.empty() && mismatched++ == 0) first = mismatch;
+    }
+    double time = double(clock() - start) / CLOCKS_PER_SEC;
+    total++;
+    if (mismatched > 0) failed++;
+    std::cout << c.op;
+    for (auto const& shp : c.shapes) std::cout << " " << shp.to_string();
+    std::cout << ": mismatched " << mismatched << "/" << samples
+      << ", time " << time << "s";
+    if (mismatched > 0) std::cout << ", first " << first;
+    std::cout << std::endl;
+  }
+  std::cout << "Oracle: " << failed << " of " << total
+    << " operators mismatched" << std::endl;
+}
+
+/*
+ * Verify the whole model of CVM symbol json, every operator node
+ *  is proved in topological order with the options of command
+ *  line, see cvm::Graph. With memo, nodes of a signature proved
+ *  before are skipped, such as the repeated blocks of model.
+ **/
+void verify_model(const std::string &path) {
+  // Name of the first node of signature.
+  std::unordered_map<std::string, std::string> verified;
+  size_t index = 0, num_ops = 0;
+  auto verify = [&](NodePtr const& node) {
+    if (node->is_variable()) return;
+    // Operators are not counted ahead when released.
+    std::cout << "[" << ++index;
+    if (num_ops > 0) std::cout << "/" << num_ops;
+    std::cout << "] " << node->op()->name << "(" << node->attrs.name
+      << ")" << std::endl;
+    if (memo) {
+      auto it = verified.emplace(node->signature(), node->attrs.name);
+      if (!it.second) {
+        std::cout << "Verdicts reused from " << it.first->second
+          << std::endl;
+        return;
+      }
+    }
+    prove_node(node);
+  };
+
+  if (release) {
+    std::cout << "Model " << path << ": nodes are released once "
+      << "verified" << std::endl;
+    Graph::Walk(path, contracts, params.get(), verify);
+  } else {
+    clock_t start = clock();
+    std::unique_ptr<Graph> graph = Graph::Load(path, contracts, params.get());
+    for (auto const& node : graph->nodes()) {
+      if (!node->is_variable()) num_ops++;
+    }
+    std::cout << "Model " << path << ": " << graph->nodes().size()
+      << " nodes, " << num_ops << " operators, build time "
+      << double(clock() - start) / CLOCKS_PER_SEC << "s" << std::endl;
+    for (auto const& node : graph->nodes()) verify(node);
+  }
+  if (memo) {
+    std::cout << "Proved " << verified.size() << " distinct of "
+      << index << " operators" << std::endl;
+  }
+}
+
+/*
+ * Benchmark of pipelined prove on a conv2d layer with feature
+ *  map of size, the obligations of every output, without uid
+ *  deduplication, are checked in batch and then in pipeline
+ *  with queue of capacity, and the wall time to the first
+ *  verdict and of all are reported.
+ **/
+void bench_pipeline(int size, unsigned timeout, unsigned rlimit,
+                    size_t capacity) {
+  using clock = std::chrono::steady_clock;
+  auto seconds = [](clock::time_point a, clock::time_point b) {
+    return std::chrono::duration<double>(b - a).count();
+  };
+  auto x = Node::CreateVariable<TypeRef>("x", Shape({1, 4, size, size}));
+  auto w = Node::CreateVariable<TypeRef>("w", Shape({4, 4, 3, 3}));
+  auto conv = Node::CreateOperator(
+    "conv2d", "conv", {x, w},
+    unordered_map<string, string>{
+      {"channels", "4"},
+      {"kernel_size", "(3, 3)"},
+      {"padding", "(1, 1)"},
+      {"use_bias", "false"},
+    });
+  if (timeout == 0 && rlimit == 0) rlimit = 2000000;
+  prover().set_ladder(default_ladder(timeout, rlimit));
+
+  auto start = clock::now();
+  std::vector<z3_expr> proves = conv.node->provements_generator(false);
+  std::vector<ProveResult> results = prover().prove(proves);
+  proves.clear();
+  double batch = seconds(start, clock::now());
+  size_t proved = 0;
+  for (auto const& r : results) {
+    if (r.status == ProveStatus::kDeterministic) proved++;
+  }
+  std::cout << "batch: proved " << proved << "/" << results.size()
+    << ", first verdict " << batch << "s, total " << batch << "s"
+    << std::endl;
+
+  start = clock::now();
+  clock::time_point first;
+  size_t reported = 0;
+  proved = 0;
+  ObligationCursor cursor = conv.node->obligations(false);
+  prover().prove_stream(
+      cursor, z3_expr(true),
+      [&](ProveResult const& r) {
+        if (reported++ == 0) first = clock::now();
+        if (r.status == ProveStatus::kDeterministic) proved++;
+      }, conv.node->op(), capacity);
+  auto end = clock::now();
+  std::cout << "pipeline " << capacity << ": proved " << proved
+    << "/" << reported << ", first verdict " << seconds(start, first)
+    << "s, total " << seconds(start, end) << "s" << std::endl;
+}
+
+/*
+ * Benchmark of graph building, a chain of conv2d, elemwise_add
+ *  and relu is built without proving, and the time and peak
+ *  resident memory of process are reported. Peak memory only
+ *  grows, so compare different settings in separate runs.
+ **/
+void bench_graph(int size) {
+  clock_t start = clock();
+  size_t outputs = 0;
+  {
+    auto x = Node::CreateVariable<TypeRef>("x", Shape({1, 4, size, size}));
+    auto w = Node::CreateVariable<TypeRef>("w", Shape({4, 4, 3, 3}));
+    auto conv = Node::CreateOperator(
+      "conv2d", "conv", {x, w},
+      unordered_map<string, string>{
+        {"channels", "4"},
+        {"kernel_size", "(3, 3)"},
+        {"padding", "(1, 1)"},
+        {"use_bias", "false"},
+      });
+    auto add = Node::CreateOperator("elemwise_add", "add", {conv, x});
+    auto relu = Node::CreateOperator("relu", "relu", {add});
+    outputs = conv->Size() + add->Size() + relu->Size();
+  }
+  double time = double(clock() - start) / CLOCKS_PER_SEC;
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  std::cout << "Graph of " << outputs << " outputs"
+    << ", build time " << time << "s"
+    << ", peak RSS " << usage.ru_maxrss / 1024 << "MB";
+  std::cout << std::endl;
+}
+
+/*
+ * Usage: z3_prover [op_name] [key=value ...]
+ *
+ *  supported options:
+ *    workers: number of concurrent prover workers, 0 means
+ *      hardware concurrency, default 1.
+ *    incremental: check obligations of node in one incremental
+ *      solver session, default false.
+ *    canonical: check all the obligations of node, deduplicated
+ *      by alpha-canonical form, default false.
+ *    syntactic: close obligations of data-movement operators
+ *      without solver, default false.
+ *    interval: close range obligations by interval analysis
+ *      without solver, default false.
+ *    compositional: close outputs of dense and conv2d by the
+ *      lemma of multiply-accumulate without solver, default
+ *      false.
+ *    width: `adaptive` checks obligations over the smallest
+ *      bit-vector width which all the terms fit in, default
+ *      64 bits.
+ *    timeout, rlimit: budget of every obligation in milliseconds
+ *      and z3 resource units, checked with escalation ladder of
+ *      quick, tactic, split and final steps, default unlimited.
+ *    portfolio: race tactic strategies on every obligation with
+ *      the budget of timeout and rlimit, and report the wins of
+ *      every strategy per operator, default false.
+ *    pipeline: capacity of obligation queue, obligations are
+ *      built while the workers are checking and the verdicts are
+ *      reported as soon as checked, not applied with canonical,
+ *      adaptive width and cache, default 0 as disabled.
+ *    model: path of CVM symbol json, the whole model is verified
+ *      instead of the op test.
+ *    contracts: verify the model assume-guarantee, operators
+ *      assume only the precision contracts of their inputs
+ *      proven upstream, default false.
+ *    memo: reuse the verdicts of operator with the same
+ *      signature proved before in the model, default false.
+ *    release: release the tensors and obligations of node once
+ *      its consumers are verified, so that memory is bounded by
+ *      the widest frontier of model, default false.
+ *    params: path of CVM params file, the weights of model are
+ *      bound to the concrete values instead of symbols, default
+ *      disabled.
+ *    cache: path of persistent proof cache, verdicts of checked
+ *      obligations are reused across runs, default disabled.
+ *    theory: `int` represents data in integer arithmetic instead
+ *      of 64 bits bit-vector, default bit-vector.
+ *    bench: `theory` runs the benchmark of theory backends per
+ *      operator, `simplify` runs the benchmark of simplify
+ *      `levels` per operator, default all, separated by comma
+ *      such as `levels=3,4,6,10`, `reduce` runs the benchmark of
+ *      reduction modes on dense and conv2d sweeps with first
+ *      `samples` obligations of node, default 1, `reduce_equal`
+ *      proves the outputs of dense, conv2d, sum and max equal in
+ *      both reduction modes, `graph` runs the benchmark of graph
+ *      building with feature map of `size`, default 32,
+ *      `pipeline` runs the benchmark of batch and pipelined
+ *      prove on conv2d with feature map of `size`, default 8,
+ *      `oracle` runs the differential test of
+ *      forward functions against the concrete executors on
+ *      `samples` random inputs per operator, default 16,
+ *      instead of the op test.
+ *    reduce: `tree` accumulates dense, conv2d and sum in balanced
+ *      tree instead of linear chain, default linear.
+ *    simplify: simplify level of constraints in [0, 10], see
+ *      base.h, default SIMPLIFY_LEVEL of build.
+ *    simplify.<op>: simplify level of the operator only, such
+ *      as `simplify.dense=4`.
+ **/
+int main(int argc, char *argv[]) {
   // z3_expr_deterministic();
   // return 0;
   
   // generator_prove();
   // return 0;
 
-  big_test("conv2d");
+  std::string op_name = "conv2d";
+  unordered_map<string, string> options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    size_t pos = arg.find('=');
+    if (pos == std::string::npos) {
+      op_name = arg;
+    } else {
+      options[arg.substr(0, pos)] = arg.substr(pos + 1);
+    }
+  }
+  if (options.count("workers")) {
+    num_workers = std::stoi(options["workers"]);
+    if (num_workers == 0) num_workers = std::thread::hardware_concurrency();
+  }
+
+  // Data built from now on are in the theory.
+  if (options["theory"] == "int") SetTheory(Theory::kInteger);
+  if (options["reduce"] == "tree") SetReduceMode(ReduceMode::kTree);
+  if (options.count("simplify")) {
+    SetSimplifyLevel(std::stoi(options["simplify"]));
+  }
+  for (auto const& kv : options) {
+    if (kv.first.compare(0, 9, "simplify.") != 0) continue;
+    std::string name = kv.first.substr(9);
+    Op::Get(name); // verify registered
+    z3::utils::Registry<Op>::Get()->__REGISTER_OR_GET__(name)
+      .set_simplify_level(std::stoi(kv.second));
+  }
+  incremental = options["incremental"] == "true";
+  canonical = options["canonical"] == "true";
+  syntactic = options["syntactic"] == "true";
+  interval_analysis = options["interval"] == "true";
+  compositional = options["compositional"] == "true";
+  adaptive_width = options["width"] == "adaptive";
+  contracts = options["contracts"] == "true";
+  memo = options["memo"] == "true";
+  release = options["release"] == "true";
+  if (options.count("params")) {
+    params.reset(new Params(options["params"]));
+    std::cout << "Params " << params->path() << ": " << params->size()
+      << " tensors" << std::endl;
+  }
+  if (options.count("pipeline")) pipeline = std::stoul(options["pipeline"]);
+  ladder = default_ladder(
+      options.count("timeout") ? std::stoul(options["timeout"]) : 0,
+      options.count("rlimit") ? std::stoul(options["rlimit"]) : 0);
+  if (options["portfolio"] == "true") {
+    portfolio = default_portfolio(
+      options.count("timeout") ? std::stoul(options["timeout"]) : 0,
+      options.count("rlimit") ? std::stoul(options["rlimit"]) : 0);
+  }
+  if (options.count("cache")) {
+    proof_cache.reset(new ProofCache(options["cache"]));
+    std::cout << "Proof cache: " << options["cache"]
+      << ", " << proof_cache->size() << " records" << std::endl;
+  }
+
+  if (options["bench"] == "theory") {
+    bench_theory(
+      options.count("timeout") ? std::stoul(options["timeout"]) : 0,
+      options.count("rlimit") ? std::stoul(options["rlimit"]) : 0);
+    return 0;
+  }
+  if (options["bench"] == "simplify") {
+    std::vector<int> levels;
+    std::stringstream ss(options.count("levels") ?
+        options["levels"] : "0,1,2,3,4,5,6,7,8,9,10");
+    for (std::string l; std::getline(ss, l, ',');) {
+      levels.push_back(std::stoi(l));
+    }
+    bench_simplify(
+      options.count("timeout") ? std::stoul(options["timeout"]) : 0,
+      options.count("rlimit") ? std::stoul(options["rlimit"]) : 0,
+      levels);
+    return 0;
+  }
+  if (options["bench"] == "reduce") {
+    bench_reduce(
+      options.count("timeout") ? std::stoul(options["timeout"]) : 0,
+      options.count("rlimit") ? std::stoul(options["rlimit"]) : 0,
+      options.count("samples") ? std::stoul(options["samples"]) : 1);
+    return 0;
+  }
+  if (options["bench"] == "reduce_equal") {
+    compare_reduce(
+      options.count("timeout") ? std::stoul(options["timeout"]) : 0,
+      options.count("rlimit") ? std::stoul(options["rlimit"]) : 0);
+    return 0;
+  }
+  if (options["bench"] == "oracle") {
+    bench_oracle(options.count("samples") ? std::stoul(options["samples"]) : 16);
+    return 0;
+  }
+  if (options["bench"] == "pipeline") {
+    bench_pipeline(options.count("size") ? std::stoi(options["size"]) : 8,
+      options.count("timeout") ? std::stoul(options["timeout"]) : 0,
+      options.count("rlimit") ? std::stoul(options["rlimit"]) : 0,
+      pipeline > 0 ? pipeline : 64);
+    return 0;
+  }
+  if (options["bench"] == "graph") {
+    bench_graph(options.count("size") ? std::stoi(options["size"]) : 32);
+    return 0;
+  }
+  if (options.count("model")) {
+    verify_model(options["model"]);
+  } else {
+    big_test(op_name);
+  }
+  for (auto const& op : prover().portfolio_wins()) {
+    std::cout << "Portfolio wins of " << op.first << ":";
+    for (auto const& w : op.second) {
+      std::cout << " " << w.first << "=" << w.second;
+    }
+    std::cout << std::endl;
+  }
   return 0;
   int num_inputs = 3;
   auto a = Node::CreateVariable<TypeRef>("a", Shape({2, num_inputs}), 24);
@@ -874,8 +1702,7 @@ int main() {
     {"a_min", "-19"},
     {"scale", "2"},
   });
-  for (auto &p : ret.node->provements_generator(true))
-    z3_prover(p.cstr);
+  prove_node(ret.node);
 
   return 0;
 